@@ -0,0 +1,340 @@
+// Throughput benchmark, run by `make bench`, prints CSV to stdout
+//
+// usage: bench [-p ft_ssl] [-t min_seconds] [size...]
+// Sizes take an optional K, M or G suffix (powers of 1024), the default goes from 0 B to 1 GiB
+//
+// Every size is measured twice:
+// - "kernel" rows call the library directly: the streaming context, every entry of the kernel tables the cpu
+//   supports and the multi-buffer algorithms (which hash one message of that size per lane)
+// - "e2e" rows run the `ft_ssl` binary given with -p on a temporary file, as a file argument (mmap path),
+//   with -uring, and fed through a pipe on stdin (read path), so they include process startup
+//
+// The numbers only mean something for an optimized build, e.g. `make re bench CFLAGS="-Wall -Wextra -Werror -O2 -Isrc -pthread"`
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "context.h"
+#include "hash.h"
+#include "md5.h"
+#include "multibuffer.h"
+#include "sha256.h"
+#include "whirlpool.h"
+
+extern char **environ;
+
+static size_t const default_sizes[] = {
+	0, 64, 1024, 16 * 1024, 1024 * 1024, 64 * 1024 * 1024, 1024 * 1024 * 1024,
+};
+
+static double min_seconds = 0.5;
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_row(char const *kind, char const *alg, char const *variant, size_t size, size_t iterations, double seconds) {
+	double mb_per_s = seconds > 0 ? (double)size * iterations / seconds / 1e6 : 0;
+	double ns_per_op = seconds * 1e9 / iterations;
+	printf("%s,%s,%s,%zu,%zu,%.6f,%.2f,%.1f\n", kind, alg, variant, size, iterations, seconds, mb_per_s, ns_per_op);
+	fflush(stdout);
+}
+
+/// Hashes `len` bytes of `data` into `hash`, which is big enough for any algorithm
+typedef void (t_hash_fn)(void const *variant, uint8_t const *data, size_t len, uint8_t *hash);
+
+/// Repeats `fn` until at least `min_seconds` passed, returns the amount of calls and their total time in `seconds`
+static size_t measure(t_hash_fn *fn, void const *variant, uint8_t const *data, size_t len, uint8_t *hash, double *seconds) {
+	size_t iterations = 0;
+	double start = now();
+	do {
+		fn(variant, data, len, hash);
+		iterations++;
+		*seconds = now() - start;
+	} while (*seconds < min_seconds);
+	return iterations;
+}
+
+static void md5_ctx_hash(void const *variant, uint8_t const *data, size_t len, uint8_t *hash) {
+	(void)variant;
+	struct md5_ctx ctx;
+	md5_init(&ctx);
+	md5_update(&ctx, data, len);
+	md5_final(&ctx, (struct hash128 *)hash);
+}
+
+static void sha256_ctx_hash(void const *variant, uint8_t const *data, size_t len, uint8_t *hash) {
+	(void)variant;
+	struct sha256_ctx ctx;
+	sha256_init(&ctx);
+	sha256_update(&ctx, data, len);
+	sha256_final(&ctx, (struct hash256 *)hash);
+}
+
+static void whirlpool_ctx_hash(void const *variant, uint8_t const *data, size_t len, uint8_t *hash) {
+	(void)variant;
+	struct whirlpool_ctx ctx;
+	whirlpool_init(&ctx);
+	whirlpool_update(&ctx, data, len);
+	whirlpool_final(&ctx, (struct hash512 *)hash);
+}
+
+static void sha256_kernel_hash(void const *variant, uint8_t const *data, size_t len, uint8_t *hash) {
+	struct sha256_kernel const *kernel = variant;
+	struct sha256_state state = sha256_state();
+	kernel->rounds(&state, data, len / 64);
+	*(struct hash256 *)hash = sha256_final_round(state, data + len / 64 * 64, len % 64 * 8);
+}
+
+static void whirlpool_kernel_hash(void const *variant, uint8_t const *data, size_t len, uint8_t *hash) {
+	struct whirlpool_kernel const *kernel = variant;
+	struct whirlpool_state state = whirlpool_state();
+	kernel->rounds(state.rows, data, len / 64);
+	// Kernels leave the length to `whirlpool_rounds`, its least significant word is first
+	state.msg_len[0] = (uint64_t)(len / 64) * 512;
+	*(struct hash512 *)hash = whirlpool_final_round(state, data + len / 64 * 64, len % 64 * 8);
+}
+
+/// Hashes one copy of `data` per lane, only the hash of the first lane is kept
+static void mb_hash(void const *variant, uint8_t const *data, size_t len, uint8_t *hash) {
+	struct mb_algorithm const *alg = variant;
+	struct mb_job jobs[MB_MAX_LANES];
+	uint8_t hashes[MB_MAX_LANES][64];
+	for (size_t i = 0; i < alg->lanes; i++) {
+		jobs[i] = (struct mb_job){ .data = data, .len = len, .hash = hashes[i] };
+	}
+	mb_hash_jobs(alg, jobs, alg->lanes);
+	memcpy(hash, hashes[0], 64);
+}
+
+/// Measures one variant and checks its hash against the one of the streaming context in `expected`
+/// `lanes` is the amount of messages of `len` bytes hashed by one call
+static void bench_variant(char const *alg, char const *variant_name, t_hash_fn *fn, void const *variant,
+		uint8_t const *data, size_t len, size_t lanes, uint8_t const *expected, size_t hash_size) {
+	uint8_t hash[64];
+	double seconds;
+	size_t iterations = measure(fn, variant, data, len, hash, &seconds);
+	if (expected != NULL && memcmp(hash, expected, hash_size) != 0) {
+		fprintf(stderr, "bench: %s %s gives a wrong hash for %zu bytes\n", alg, variant_name, len);
+	}
+	print_row("kernel", alg, variant_name, len, iterations * lanes, seconds);
+}
+
+static void bench_kernels(uint8_t const *data, size_t len) {
+	uint8_t expected[64];
+	char name[64];
+
+	md5_ctx_hash(NULL, data, len, expected);
+	bench_variant("md5", "ctx", &md5_ctx_hash, NULL, data, len, 1, NULL, 16);
+	struct mb_algorithm const *md5_alg = md5_mb();
+	if (md5_alg != NULL) {
+		snprintf(name, sizeof(name), "mb-%s", md5_alg->name);
+		bench_variant("md5", name, &mb_hash, md5_alg, data, len, md5_alg->lanes, expected, 16);
+	}
+
+	sha256_ctx_hash(NULL, data, len, expected);
+	bench_variant("sha256", "ctx", &sha256_ctx_hash, NULL, data, len, 1, NULL, 32);
+	for (size_t i = 0; sha256_kernels[i].name != NULL; i++) {
+		if (sha256_kernels[i].supported()) {
+			bench_variant("sha256", sha256_kernels[i].name, &sha256_kernel_hash, &sha256_kernels[i], data, len, 1, expected, 32);
+		}
+	}
+	struct mb_algorithm const *sha256_alg = sha256_mb();
+	if (sha256_alg != NULL) {
+		snprintf(name, sizeof(name), "mb-%s", sha256_alg->name);
+		bench_variant("sha256", name, &mb_hash, sha256_alg, data, len, sha256_alg->lanes, expected, 32);
+	}
+
+	whirlpool_ctx_hash(NULL, data, len, expected);
+	bench_variant("whirlpool", "ctx", &whirlpool_ctx_hash, NULL, data, len, 1, NULL, 64);
+	for (size_t i = 0; whirlpool_kernels[i].name != NULL; i++) {
+		if (whirlpool_kernels[i].supported()) {
+			bench_variant("whirlpool", whirlpool_kernels[i].name, &whirlpool_kernel_hash, &whirlpool_kernels[i], data, len, 1, expected, 64);
+		}
+	}
+}
+
+/// Writes all of `data` to `fd`, returns false on failure
+static bool write_all(int fd, uint8_t const *data, size_t len) {
+	while (len > 0) {
+		ssize_t written = write(fd, data, len);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += written;
+		len -= written;
+	}
+	return true;
+}
+
+/// Runs `argv` with its output discarded, when `data` is not NULL it is written to the standard input
+static bool run(char *const *argv, uint8_t const *data, size_t len) {
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+	int pipe_fds[2] = { -1, -1 };
+	if (data != NULL) {
+		if (pipe(pipe_fds) != 0) {
+			posix_spawn_file_actions_destroy(&actions);
+			return false;
+		}
+		posix_spawn_file_actions_adddup2(&actions, pipe_fds[0], STDIN_FILENO);
+		posix_spawn_file_actions_addclose(&actions, pipe_fds[0]);
+		posix_spawn_file_actions_addclose(&actions, pipe_fds[1]);
+	}
+
+	pid_t pid;
+	int err = posix_spawn(&pid, argv[0], &actions, NULL, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	bool ok = err == 0;
+	if (data != NULL) {
+		close(pipe_fds[0]);
+		ok = ok && write_all(pipe_fds[1], data, len);
+		close(pipe_fds[1]);
+	}
+	int status;
+	if (err == 0 && waitpid(pid, &status, 0) == pid) {
+		ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+	return ok;
+}
+
+static void bench_e2e(char *ft_ssl, uint8_t const *data, size_t len) {
+	char path[] = "/tmp/ft_ssl_bench.XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0 || !write_all(fd, data, len)) {
+		perror("bench: temporary file");
+		if (fd >= 0) {
+			close(fd);
+			unlink(path);
+		}
+		return;
+	}
+	close(fd);
+
+	char *const algs[] = { "md5", "sha256", "whirlpool" };
+	for (size_t i = 0; i < sizeof(algs) / sizeof(algs[0]); i++) {
+		struct {
+			char const *name;
+			char *argv[6];
+			bool piped;
+		} const modes[] = {
+			{ "mmap", { ft_ssl, algs[i], "-q", path, NULL }, false },
+			{ "uring", { ft_ssl, algs[i], "-q", "-uring", path, NULL }, false },
+			{ "stdin", { ft_ssl, algs[i], "-q", NULL }, true },
+		};
+		for (size_t j = 0; j < sizeof(modes) / sizeof(modes[0]); j++) {
+			size_t iterations = 0;
+			double seconds;
+			double start = now();
+			do {
+				if (!run(modes[j].argv, modes[j].piped ? data : NULL, len)) {
+					fprintf(stderr, "bench: %s %s failed for %zu bytes\n", algs[i], modes[j].name, len);
+					break;
+				}
+				iterations++;
+				seconds = now() - start;
+			} while (seconds < min_seconds);
+			if (iterations > 0) {
+				print_row("e2e", algs[i], modes[j].name, len, iterations, seconds);
+			}
+		}
+	}
+	unlink(path);
+}
+
+/// Parses a size with an optional K, M or G suffix
+static bool parse_size(char const *str, size_t *size) {
+	char *end;
+	errno = 0;
+	unsigned long long n = strtoull(str, &end, 10);
+	if (end == str || errno != 0) {
+		return false;
+	}
+	int shift = 0;
+	if (*end == 'K' || *end == 'M' || *end == 'G') {
+		shift = *end == 'K' ? 10 : *end == 'M' ? 20 : 30;
+		end++;
+	}
+	if (*end != '\0' || n > SIZE_MAX >> shift) {
+		return false;
+	}
+	*size = (size_t)n << shift;
+	return true;
+}
+
+int main(int argc, char **argv) {
+	char *ft_ssl = "./ft_ssl";
+	int opt;
+	while ((opt = getopt(argc, argv, "p:t:")) != -1) {
+		if (opt == 'p') {
+			ft_ssl = optarg;
+		}
+		else if (opt == 't') {
+			min_seconds = strtod(optarg, NULL);
+		}
+		else {
+			fprintf(stderr, "usage: %s [-p ft_ssl] [-t min_seconds] [size...]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	size_t size_num = argc - optind;
+	size_t const *sizes = default_sizes;
+	if (size_num == 0) {
+		size_num = sizeof(default_sizes) / sizeof(default_sizes[0]);
+	}
+	else {
+		size_t *parsed = malloc(size_num * sizeof(*parsed));
+		if (parsed == NULL) {
+			perror("bench");
+			return 1;
+		}
+		for (size_t i = 0; i < size_num; i++) {
+			if (!parse_size(argv[optind + i], &parsed[i])) {
+				fprintf(stderr, "bench: invalid size: %s\n", argv[optind + i]);
+				return 1;
+			}
+		}
+		sizes = parsed;
+	}
+
+	size_t max_size = 0;
+	for (size_t i = 0; i < size_num; i++) {
+		max_size = sizes[i] > max_size ? sizes[i] : max_size;
+	}
+	uint8_t *data = malloc(max_size + 1);
+	if (data == NULL) {
+		perror("bench");
+		return 1;
+	}
+	uint64_t x = 0x9e3779b97f4a7c15;
+	for (size_t i = 0; i < max_size; i++) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		data[i] = x;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	printf("kind,algorithm,variant,bytes,iterations,seconds,mb_per_s,ns_per_op\n");
+	for (size_t i = 0; i < size_num; i++) {
+		bench_kernels(data, sizes[i]);
+		bench_e2e(ft_ssl, data, sizes[i]);
+	}
+	return 0;
+}
@@ -0,0 +1,228 @@
+// Hardware counter microbenchmark of the compression functions, run by `make counters`, prints CSV to stdout
+//
+// usage: counters [-n bytes] [-r repeats]
+// Every kernel compresses the same buffer (64 KiB by default, so it stays in L2) `repeats` times,
+// the counters only cover the calls to the kernel
+//
+// Counters the kernel or the cpu does not provide (in most virtual machines, or with a high
+// /proc/sys/kernel/perf_event_paranoid) are left empty, as are the values derived from them
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "md5.h"
+#include "multibuffer.h"
+#include "sha256.h"
+#include "whirlpool.h"
+
+enum e_counter {
+	C_CYCLES,
+	C_INSTRUCTIONS,
+	C_L1D_MISSES,
+	C_BRANCH_MISSES,
+	C_TASK_CLOCK,
+	C_COUNT,
+};
+
+static struct {
+	char const *name;
+	uint32_t type;
+	uint64_t config;
+} const counters[C_COUNT] = {
+	[C_CYCLES] = { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	[C_INSTRUCTIONS] = { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	[C_L1D_MISSES] = { "l1d_misses", PERF_TYPE_HW_CACHE,
+		PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+	[C_BRANCH_MISSES] = { "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	[C_TASK_CLOCK] = { "task_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+};
+
+static int counter_fds[C_COUNT];
+
+/// Opens every counter for this thread, a counter that can't be opened gets -1
+static void open_counters(void) {
+	for (size_t i = 0; i < C_COUNT; i++) {
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = counters[i].type;
+		attr.config = counters[i].config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		counter_fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if (counter_fds[i] < 0) {
+			fprintf(stderr, "counters: %s unavailable: %s\n", counters[i].name, strerror(errno));
+		}
+	}
+}
+
+static void set_counters(bool enable) {
+	for (size_t i = 0; i < C_COUNT; i++) {
+		if (counter_fds[i] >= 0) {
+			if (enable) {
+				ioctl(counter_fds[i], PERF_EVENT_IOC_RESET, 0);
+			}
+			ioctl(counter_fds[i], enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+		}
+	}
+}
+
+/// Reads a counter, scaled up when the kernel had to multiplex it with other events, -1 when unavailable
+static double read_counter(enum e_counter counter) {
+	uint64_t values[3];
+	if (counter_fds[counter] < 0 || read(counter_fds[counter], values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+		return -1;
+	}
+	return (double)values[0] * values[1] / values[2];
+}
+
+/// Compresses the whole blocks of `m` with one variant
+typedef void (t_compress_fn)(void const *variant, uint8_t const *m, size_t blocks);
+
+static void md5_compress(void const *variant, uint8_t const *m, size_t blocks) {
+	(void)variant;
+	struct md5_state state = md5_state();
+	md5_rounds(&state, m, blocks);
+}
+
+static void sha256_compress(void const *variant, uint8_t const *m, size_t blocks) {
+	struct sha256_kernel const *kernel = variant;
+	struct sha256_state state = sha256_state();
+	kernel->rounds(&state, m, blocks);
+}
+
+static void whirlpool_compress(void const *variant, uint8_t const *m, size_t blocks) {
+	struct whirlpool_kernel const *kernel = variant;
+	struct whirlpool_state state = whirlpool_state();
+	kernel->rounds(state.rows, m, blocks);
+}
+
+/// Every lane compresses its own slice of `m`, so the amount of bytes matches the other variants
+static void mb_compress(void const *variant, uint8_t const *m, size_t blocks) {
+	struct mb_algorithm const *alg = variant;
+	_Alignas(64) uint32_t states[MB_MAX_LANES * MB_MAX_STATE_WORDS];
+	uint8_t const *lane_blocks[MB_MAX_LANES];
+	size_t per_lane = blocks / alg->lanes;
+	for (size_t lane = 0; lane < alg->lanes; lane++) {
+		alg->init_lane(states, lane);
+	}
+	for (size_t i = 0; i < per_lane; i++) {
+		for (size_t lane = 0; lane < alg->lanes; lane++) {
+			lane_blocks[lane] = m + (lane * per_lane + i) * 64;
+		}
+		alg->kernel(states, lane_blocks);
+	}
+}
+
+static void print_value(double value, char const *format) {
+	if (value >= 0) {
+		printf(format, value);
+	}
+}
+
+static void measure(char const *alg, char const *variant_name, t_compress_fn *fn, void const *variant,
+		uint8_t const *m, size_t blocks, size_t repeats) {
+	// One untimed pass so the buffer and the tables are cached and the code is paged in
+	fn(variant, m, blocks);
+
+	set_counters(true);
+	for (size_t i = 0; i < repeats; i++) {
+		fn(variant, m, blocks);
+	}
+	set_counters(false);
+
+	double values[C_COUNT];
+	for (size_t i = 0; i < C_COUNT; i++) {
+		values[i] = read_counter(i);
+	}
+	double bytes = (double)blocks * 64 * repeats;
+
+	printf("%s,%s,%.0f", alg, variant_name, bytes);
+	for (size_t i = 0; i < C_COUNT; i++) {
+		printf(",");
+		print_value(values[i], "%.0f");
+	}
+	printf(",");
+	print_value(values[C_CYCLES] >= 0 ? values[C_CYCLES] / bytes : -1, "%.3f");
+	printf(",");
+	print_value(values[C_CYCLES] > 0 && values[C_INSTRUCTIONS] >= 0 ? values[C_INSTRUCTIONS] / values[C_CYCLES] : -1, "%.3f");
+	printf(",");
+	print_value(values[C_L1D_MISSES] >= 0 ? values[C_L1D_MISSES] * 1024 / bytes : -1, "%.3f");
+	printf(",");
+	print_value(values[C_TASK_CLOCK] >= 0 ? values[C_TASK_CLOCK] / bytes : -1, "%.3f");
+	printf("\n");
+	fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+	size_t bytes = 64 * 1024;
+	size_t repeats = 256;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+		if (opt == 'n') {
+			bytes = strtoull(optarg, NULL, 10);
+		}
+		else if (opt == 'r') {
+			repeats = strtoull(optarg, NULL, 10);
+		}
+		else {
+			fprintf(stderr, "usage: %s [-n bytes] [-r repeats]\n", argv[0]);
+			return 1;
+		}
+	}
+	// Rounded to a whole amount of blocks for every lane of the multi-buffer kernels
+	size_t blocks = bytes / (64 * MB_MAX_LANES) * MB_MAX_LANES;
+	if (blocks == 0 || repeats == 0) {
+		fprintf(stderr, "counters: needs at least %d bytes and 1 repeat\n", 64 * MB_MAX_LANES);
+		return 1;
+	}
+
+	uint8_t *m = malloc(blocks * 64);
+	if (m == NULL) {
+		perror("counters");
+		return 1;
+	}
+	for (size_t i = 0; i < blocks * 64; i++) {
+		m[i] = i * 131 + (i >> 8);
+	}
+
+	char name[64];
+	open_counters();
+	printf("algorithm,variant,bytes");
+	for (size_t i = 0; i < C_COUNT; i++) {
+		printf(",%s", counters[i].name);
+	}
+	printf(",cycles_per_byte,ipc,l1d_misses_per_kib,ns_per_byte\n");
+
+	measure("md5", "scalar", &md5_compress, NULL, m, blocks, repeats);
+	struct mb_algorithm const *md5_alg = md5_mb();
+	if (md5_alg != NULL) {
+		snprintf(name, sizeof(name), "mb-%s", md5_alg->name);
+		measure("md5", name, &mb_compress, md5_alg, m, blocks, repeats);
+	}
+	for (size_t i = 0; sha256_kernels[i].name != NULL; i++) {
+		if (sha256_kernels[i].supported()) {
+			measure("sha256", sha256_kernels[i].name, &sha256_compress, &sha256_kernels[i], m, blocks, repeats);
+		}
+	}
+	struct mb_algorithm const *sha256_alg = sha256_mb();
+	if (sha256_alg != NULL) {
+		snprintf(name, sizeof(name), "mb-%s", sha256_alg->name);
+		measure("sha256", name, &mb_compress, sha256_alg, m, blocks, repeats);
+	}
+	for (size_t i = 0; whirlpool_kernels[i].name != NULL; i++) {
+		if (whirlpool_kernels[i].supported()) {
+			measure("whirlpool", whirlpool_kernels[i].name, &whirlpool_compress, &whirlpool_kernels[i], m, blocks, repeats);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,51 @@
+#include <stdint.h>
+
+#include "cpu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <cpuid.h>
+
+static uint64_t xgetbv(void) {
+	uint32_t eax;
+	uint32_t edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+}
+
+struct cpu_features cpu_features(void) {
+	struct cpu_features features = {0};
+	unsigned eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+		return features;
+	}
+	features.ssse3 = (ecx & bit_SSSE3) != 0;
+	features.sse41 = (ecx & bit_SSE4_1) != 0;
+
+	// AVX state has to be saved by the OS, otherwise the registers can't be used
+	bool os_avx = false;
+	bool os_avx512 = false;
+	if ((ecx & bit_OSXSAVE) != 0 && (ecx & bit_AVX) != 0) {
+		uint64_t xcr0 = xgetbv();
+		os_avx = (xcr0 & 0x06) == 0x06;
+		os_avx512 = (xcr0 & 0xe6) == 0xe6;
+	}
+
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+		return features;
+	}
+	features.avx2 = os_avx && (ebx & bit_AVX2) != 0;
+	features.avx512f = os_avx512 && (ebx & bit_AVX512F) != 0;
+	features.avx512bw = os_avx512 && (ebx & bit_AVX512BW) != 0;
+	features.sha = features.sse41 && (ebx & bit_SHA) != 0;
+	return features;
+}
+
+#else
+
+struct cpu_features cpu_features(void) {
+	struct cpu_features features = {0};
+	return features;
+}
+
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdbool.h>
+
+/// Instruction set extensions that are both supported by the cpu and enabled by the OS
+struct cpu_features {
+	bool ssse3;
+	bool sse41;
+	bool avx2;
+	bool avx512f;
+	bool avx512bw;
+	bool sha;
+};
+
+struct cpu_features cpu_features(void);
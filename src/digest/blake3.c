@@ -0,0 +1,281 @@
+#include <assert.h>
+
+#include "blake3.h"
+#include "blake3_kernels.h"
+#include "cpu.h"
+#include "endianness.h"
+#include "utils.h"
+
+uint32_t const blake3_iv[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+uint8_t const blake3_schedule[7][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+	{ 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+	{ 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+	{ 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+	{ 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+	{ 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 },
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+#define G(a, b, c, d, x, y) { \
+	(a) += (b) + (x); \
+	(d) = ROTR((d) ^ (a), 16); \
+	(c) += (d); \
+	(b) = ROTR((b) ^ (c), 12); \
+	(a) += (b) + (y); \
+	(d) = ROTR((d) ^ (a), 8); \
+	(c) += (d); \
+	(b) = ROTR((b) ^ (c), 7); \
+}
+
+/// Writes the first 8 words of the compression output to `out`, which is the new chaining value
+static void compress(uint32_t const cv[8], uint8_t const block[64], uint8_t block_len, uint64_t counter, uint8_t flags, uint32_t out[8]) {
+	uint32_t m[16];
+	load_le32x16(m, block);
+
+	uint32_t v[16] = {
+		cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+		blake3_iv[0], blake3_iv[1], blake3_iv[2], blake3_iv[3],
+		(uint32_t)counter, (uint32_t)(counter >> 32), block_len, flags,
+	};
+
+	BLAKE3_ROUNDS(G, v, m)
+
+	for (uint8_t i = 0; i < 8; i++) {
+		out[i] = v[i] ^ v[i + 8];
+	}
+}
+
+void blake3_hash_chunks_portable(uint8_t const *chunks, uint64_t counter, uint32_t *cvs) {
+	uint32_t cv[8];
+	for (uint8_t i = 0; i < 8; i++) {
+		cv[i] = blake3_iv[i];
+	}
+	for (uint8_t b = 0; b < 16; b++) {
+		uint8_t flags = (b == 0 ? BLAKE3_CHUNK_START : 0) | (b == 15 ? BLAKE3_CHUNK_END : 0);
+		compress(cv, chunks + b * 64, 64, counter, flags, cv);
+	}
+	ft_memcpy(cvs, cv, sizeof(cv));
+}
+
+static bool portable_supported(void) {
+	return true;
+}
+
+static bool sse41_supported(void) {
+	return cpu_features().sse41;
+}
+
+static bool avx2_supported(void) {
+	return cpu_features().avx2;
+}
+
+static bool avx512_supported(void) {
+	return cpu_features().avx512f;
+}
+
+struct blake3_kernel const blake3_kernels[] = {
+	{ "avx512", &avx512_supported, 16, &blake3_hash_chunks_avx512 },
+	{ "avx2", &avx2_supported, 8, &blake3_hash_chunks_avx2 },
+	{ "sse4.1", &sse41_supported, 4, &blake3_hash_chunks_sse41 },
+	{ "portable", &portable_supported, 1, &blake3_hash_chunks_portable },
+	{ NULL, NULL, 0, NULL },
+};
+
+/// The supported kernels, widest first, so the tail of a run of chunks goes to the narrower ones
+static struct blake3_kernel const *usable_kernels[sizeof(blake3_kernels) / sizeof(*blake3_kernels)] = {
+	&blake3_kernels[3],
+};
+
+__attribute__((constructor))
+static void select_kernels(void) {
+	size_t n = 0;
+	for (size_t i = 0; blake3_kernels[i].name != NULL; i++) {
+		if (blake3_kernels[i].supported()) {
+			usable_kernels[n++] = &blake3_kernels[i];
+		}
+	}
+}
+
+static void parent_cv(uint32_t const left[8], uint32_t const right[8], uint8_t flags, uint32_t out[8]) {
+	uint32_t words[16];
+	for (uint8_t i = 0; i < 8; i++) {
+		words[i] = host_to_little32(left[i]);
+		words[i + 8] = host_to_little32(right[i]);
+	}
+	compress(blake3_iv, (uint8_t const *)words, 64, 0, BLAKE3_PARENT | flags, out);
+}
+
+static void reset_chunk(struct blake3_state *state) {
+	for (uint8_t i = 0; i < 8; i++) {
+		state->cv[i] = blake3_iv[i];
+	}
+	state->blocks_done = 0;
+}
+
+struct blake3_state blake3_state(void) {
+	struct blake3_state state;
+	reset_chunk(&state);
+	state.chunk_counter = 0;
+	state.has_block = false;
+	state.stack_len = 0;
+	return state;
+}
+
+/// Adds the chaining value of the chunk `state->chunk_counter`, which is known not to be the last one
+/// Every complete subtree it finishes is merged, `chunk_counter + 1` has a trailing zero for each of them
+static void push_chunk_cv(struct blake3_state *state, uint32_t const chunk_cv[8]) {
+	uint32_t cv[8];
+	ft_memcpy(cv, chunk_cv, sizeof(cv));
+	for (uint64_t total = state->chunk_counter + 1; (total & 1) == 0; total >>= 1) {
+		state->stack_len--;
+		parent_cv(state->stack[state->stack_len], cv, 0, cv);
+	}
+	ft_memcpy(state->stack[state->stack_len], cv, sizeof(cv));
+	state->stack_len++;
+	state->chunk_counter++;
+	reset_chunk(state);
+}
+
+/// Compresses a block that is known not to be the last one of the input
+static void compress_block(struct blake3_state *state, uint8_t const block[64]) {
+	uint8_t flags = (state->blocks_done == 0 ? BLAKE3_CHUNK_START : 0) | (state->blocks_done == 15 ? BLAKE3_CHUNK_END : 0);
+	compress(state->cv, block, 64, state->chunk_counter, flags, state->cv);
+	state->blocks_done++;
+	if (state->blocks_done == 16) {
+		push_chunk_cv(state, state->cv);
+	}
+}
+
+/// Hashes `chunks` whole chunks, none of them the last one of the input, with the widest kernels that fit
+static void hash_chunks(struct blake3_state *state, uint8_t const *m, size_t chunks) {
+	uint32_t cvs[16 * 8];
+	for (size_t k = 0; usable_kernels[k] != NULL && chunks > 0; k++) {
+		struct blake3_kernel const *kernel = usable_kernels[k];
+		while (chunks >= kernel->lanes) {
+			kernel->hash_chunks(m, state->chunk_counter, cvs);
+			for (size_t i = 0; i < kernel->lanes; i++) {
+				push_chunk_cv(state, &cvs[i * 8]);
+			}
+			m += kernel->lanes * BLAKE3_CHUNK_BYTES;
+			chunks -= kernel->lanes;
+		}
+	}
+}
+
+/// `m` should be `blocks` consecutive blocks of 64 bytes (512 bits)
+void blake3_rounds(struct blake3_state *state, uint8_t const *m, size_t blocks) {
+	if (blocks == 0) {
+		return;
+	}
+	if (state->has_block) {
+		compress_block(state, state->block);
+	}
+	// The last block is kept back, everything before it can't be the end of the input
+	while (blocks > 1) {
+		if (state->blocks_done == 0 && blocks > 16) {
+			size_t chunks = (blocks - 1) / 16;
+			hash_chunks(state, m, chunks);
+			m += chunks * BLAKE3_CHUNK_BYTES;
+			blocks -= chunks * 16;
+			continue;
+		}
+		compress_block(state, m);
+		m += 64;
+		blocks--;
+	}
+	ft_memcpy(state->block, m, 64);
+	state->has_block = true;
+}
+
+/// Compresses the last block of the input (`len` bytes of `m`, or the kept block when there are none)
+/// and the parents of everything on the stack
+/// The last compression gets the root flag when `root` is set, `out` is the root hash or chaining value
+static void finish(struct blake3_state *state, uint8_t const *m, uint8_t len, bool root, uint32_t out[8]) {
+	uint8_t block[64] = {0};
+	if (len > 0) {
+		if (state->has_block) {
+			compress_block(state, state->block);
+		}
+		ft_memcpy(block, m, len);
+	}
+	else if (state->has_block) {
+		ft_memcpy(block, state->block, 64);
+		len = 64;
+	}
+
+	uint8_t flags = (state->blocks_done == 0 ? BLAKE3_CHUNK_START : 0) | BLAKE3_CHUNK_END;
+	uint8_t root_flag = root ? BLAKE3_ROOT : 0;
+	compress(state->cv, block, len, state->chunk_counter, flags | (state->stack_len == 0 ? root_flag : 0), out);
+	for (uint8_t i = state->stack_len; i > 0; i--) {
+		parent_cv(state->stack[i - 1], out, i == 1 ? root_flag : 0, out);
+	}
+}
+
+static struct hash256 hash_bytes(uint32_t const words[8]) {
+	struct hash256 hash;
+	for (uint8_t i = 0; i < 8; i++) {
+		uint32_t word = host_to_little32(words[i]);
+		ft_memcpy(hash.hash + i * 4, &word, sizeof(word));
+	}
+	return hash;
+}
+
+/// `m` should be a block of at most 512 bits (64 bytes), `bits` should be a multiple of 8
+struct hash256 blake3_final_round(struct blake3_state state, uint8_t const m[64], uint16_t bits) {
+	assert(bits <= 512 && bits % 8 == 0);
+	uint32_t out[8];
+	finish(&state, m, bits / 8, true, out);
+	return hash_bytes(out);
+}
+
+size_t blake3_subtree_bytes(size_t len, size_t parts) {
+	// Big enough for the widest kernel to be used for most of it
+	size_t chunks = 64;
+	while (chunks * BLAKE3_CHUNK_BYTES * parts < len) {
+		chunks *= 2;
+	}
+	if (chunks * BLAKE3_CHUNK_BYTES >= len) {
+		return 0;
+	}
+	return chunks * BLAKE3_CHUNK_BYTES;
+}
+
+void blake3_subtree(uint8_t const *data, size_t len, uint64_t chunk_counter, uint32_t cv[8]) {
+	assert(len > 0);
+	struct blake3_state state = blake3_state();
+	state.chunk_counter = chunk_counter;
+	size_t blocks = (len - 1) / 64;
+	blake3_rounds(&state, data, blocks);
+	finish(&state, data + blocks * 64, len - blocks * 64, false, cv);
+}
+
+/// Same merging as the chunks, with subtrees as the leaves
+struct hash256 blake3_merge_subtrees(uint32_t const (*cvs)[8], size_t n) {
+	assert(n >= 2);
+	uint32_t stack[BLAKE3_MAX_DEPTH][8];
+	size_t stack_len = 0;
+
+	for (size_t i = 0; i + 1 < n; i++) {
+		uint32_t cv[8];
+		ft_memcpy(cv, cvs[i], sizeof(cv));
+		for (size_t total = i + 1; (total & 1) == 0; total >>= 1) {
+			stack_len--;
+			parent_cv(stack[stack_len], cv, 0, cv);
+		}
+		ft_memcpy(stack[stack_len], cv, sizeof(cv));
+		stack_len++;
+	}
+
+	uint32_t out[8];
+	ft_memcpy(out, cvs[n - 1], sizeof(out));
+	for (size_t i = stack_len; i > 0; i--) {
+		parent_cv(stack[i - 1], out, i == 1 ? BLAKE3_ROOT : 0, out);
+	}
+	return hash_bytes(out);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash.h"
+
+#define BLAKE3_BLOCK_BYTES 64
+#define BLAKE3_CHUNK_BYTES 1024
+
+/// Enough chaining values for 2^54 chunks, the largest input the 64-bit chunk counter allows
+#define BLAKE3_MAX_DEPTH 54
+
+/// The input is split into chunks of 16 blocks, whose chaining values are the leaves of a binary tree
+/// The last block has different flags, so it is only compressed once it's known whether more data follows
+struct blake3_state {
+	uint32_t cv[8]; // of the current chunk
+	uint64_t chunk_counter;
+	uint8_t blocks_done; // of the current chunk, already in `cv`
+
+	bool has_block;
+	uint8_t block[BLAKE3_BLOCK_BYTES];
+
+	/// Chaining values of complete subtrees, from the largest to the smallest
+	uint8_t stack_len;
+	uint32_t stack[BLAKE3_MAX_DEPTH][8];
+};
+
+struct blake3_state blake3_state(void);
+
+/// `m` should be `blocks` consecutive blocks of 64 bytes (512 bits)
+void blake3_rounds(struct blake3_state *state, uint8_t const *m, size_t blocks);
+
+/// `m` should be a block of at most 512 bits (64 bytes), `bits` should be a multiple of 8
+struct hash256 blake3_final_round(struct blake3_state state, uint8_t const m[64], uint16_t bits);
+
+/// Size of the subtrees to split an input of `len` bytes in, so that there are about `parts` of them
+/// Returns 0 when the input is too small to be split
+size_t blake3_subtree_bytes(size_t len, size_t parts);
+
+/// Chaining value of the subtree of `len` bytes, which starts at chunk `chunk_counter` of the input
+/// Only valid for the subtrees `blake3_subtree_bytes` gives: a whole subtree, or what is left of the input after them
+void blake3_subtree(uint8_t const *data, size_t len, uint64_t chunk_counter, uint32_t cv[8]);
+
+/// Root hash of an input split into `n` (at least 2) subtrees of `blake3_subtree_bytes`, given their chaining values
+struct hash256 blake3_merge_subtrees(uint32_t const (*cvs)[8], size_t n);
+
+/// Hashes `lanes` consecutive whole chunks at `chunks`, the first one being chunk `counter` of the input
+/// Writes the chaining value of chunk `i` to `cvs[i * 8]`
+typedef void (t_blake3_hash_chunks)(uint8_t const *chunks, uint64_t counter, uint32_t *cvs);
+
+struct blake3_kernel {
+	char const *name;
+	bool (*supported)(void);
+	size_t lanes;
+	t_blake3_hash_chunks *hash_chunks;
+};
+
+/// Every implementation of `t_blake3_hash_chunks` from most to least preferred, terminated by a NULL name
+/// Runs of chunks are hashed with the first one the cpu supports, the rest with the next ones that fit
+extern struct blake3_kernel const blake3_kernels[];
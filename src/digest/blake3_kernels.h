@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "blake3.h"
+
+#define BLAKE3_CHUNK_START (1 << 0)
+#define BLAKE3_CHUNK_END (1 << 1)
+#define BLAKE3_PARENT (1 << 2)
+#define BLAKE3_ROOT (1 << 3)
+
+/// Same as the SHA-256 initial value, it is also the key when hashing without one
+extern uint32_t const blake3_iv[8];
+
+/// Order of the message words in each of the 7 rounds
+extern uint8_t const blake3_schedule[7][16];
+
+/// One round: `G` on the columns, then on the diagonals of the 4x4 state `v`
+/// `r` has to be a constant, so the compiler resolves the schedule
+#define BLAKE3_ROUND(G, v, m, r) \
+	G((v)[0], (v)[4], (v)[8], (v)[12], (m)[blake3_schedule[r][0]], (m)[blake3_schedule[r][1]]) \
+	G((v)[1], (v)[5], (v)[9], (v)[13], (m)[blake3_schedule[r][2]], (m)[blake3_schedule[r][3]]) \
+	G((v)[2], (v)[6], (v)[10], (v)[14], (m)[blake3_schedule[r][4]], (m)[blake3_schedule[r][5]]) \
+	G((v)[3], (v)[7], (v)[11], (v)[15], (m)[blake3_schedule[r][6]], (m)[blake3_schedule[r][7]]) \
+	G((v)[0], (v)[5], (v)[10], (v)[15], (m)[blake3_schedule[r][8]], (m)[blake3_schedule[r][9]]) \
+	G((v)[1], (v)[6], (v)[11], (v)[12], (m)[blake3_schedule[r][10]], (m)[blake3_schedule[r][11]]) \
+	G((v)[2], (v)[7], (v)[8], (v)[13], (m)[blake3_schedule[r][12]], (m)[blake3_schedule[r][13]]) \
+	G((v)[3], (v)[4], (v)[9], (v)[14], (m)[blake3_schedule[r][14]], (m)[blake3_schedule[r][15]])
+
+#define BLAKE3_ROUNDS(G, v, m) \
+	BLAKE3_ROUND(G, v, m, 0) \
+	BLAKE3_ROUND(G, v, m, 1) \
+	BLAKE3_ROUND(G, v, m, 2) \
+	BLAKE3_ROUND(G, v, m, 3) \
+	BLAKE3_ROUND(G, v, m, 4) \
+	BLAKE3_ROUND(G, v, m, 5) \
+	BLAKE3_ROUND(G, v, m, 6)
+
+void blake3_hash_chunks_portable(uint8_t const *chunks, uint64_t counter, uint32_t *cvs);
+
+/// 4 chunks at once, their message words are transposed with unpack instructions
+void blake3_hash_chunks_sse41(uint8_t const *chunks, uint64_t counter, uint32_t *cvs);
+
+/// 8 chunks at once, their message words are gathered
+void blake3_hash_chunks_avx2(uint8_t const *chunks, uint64_t counter, uint32_t *cvs);
+
+/// 16 chunks at once, their message words are gathered
+void blake3_hash_chunks_avx512(uint8_t const *chunks, uint64_t counter, uint32_t *cvs);
@@ -0,0 +1,226 @@
+#include "blake3_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+
+# define SSE41 __attribute__((target("sse4.1")))
+# define AVX2 __attribute__((target("avx2")))
+# define AVX512 __attribute__((target("avx2,avx512f")))
+
+// Every kernel keeps word `i` of the state of all lanes in `v[i]`, lane `l` hashing chunk `counter + l`
+
+/// Low and high words of the chunk counter of every lane
+static void lane_counters(uint64_t counter, size_t lanes, uint32_t low[16], uint32_t high[16]) {
+	for (size_t l = 0; l < lanes; l++) {
+		low[l] = (uint32_t)(counter + l);
+		high[l] = (uint32_t)((counter + l) >> 32);
+	}
+}
+
+/// Stores the chaining values held word-major in `h` lane by lane
+static void store_cvs(uint32_t const *h, size_t lanes, uint32_t *cvs) {
+	for (size_t l = 0; l < lanes; l++) {
+		for (size_t i = 0; i < 8; i++) {
+			cvs[l * 8 + i] = h[i * lanes + l];
+		}
+	}
+}
+
+# define ROT16_128(x) _mm_shuffle_epi8((x), rot16)
+# define ROT8_128(x) _mm_shuffle_epi8((x), rot8)
+# define ROTN_128(x, n) _mm_or_si128(_mm_srli_epi32((x), (n)), _mm_slli_epi32((x), 32 - (n)))
+
+# define G128(a, b, c, d, x, y) { \
+	(a) = _mm_add_epi32(_mm_add_epi32((a), (b)), (x)); \
+	(d) = ROT16_128(_mm_xor_si128((d), (a))); \
+	(c) = _mm_add_epi32((c), (d)); \
+	(b) = ROTN_128(_mm_xor_si128((b), (c)), 12); \
+	(a) = _mm_add_epi32(_mm_add_epi32((a), (b)), (y)); \
+	(d) = ROT8_128(_mm_xor_si128((d), (a))); \
+	(c) = _mm_add_epi32((c), (d)); \
+	(b) = ROTN_128(_mm_xor_si128((b), (c)), 7); \
+}
+
+/// Loads block `b` of the 4 chunks, word `i` of all of them ends up in `m[i]`
+SSE41 static void load_block_sse41(__m128i m[16], uint8_t const *chunks, size_t b) {
+	for (size_t g = 0; g < 4; g++) {
+		__m128i r[4];
+		for (size_t l = 0; l < 4; l++) {
+			r[l] = _mm_loadu_si128((__m128i const *)(chunks + l * BLAKE3_CHUNK_BYTES + b * 64 + g * 16));
+		}
+		__m128i t0 = _mm_unpacklo_epi32(r[0], r[1]);
+		__m128i t1 = _mm_unpacklo_epi32(r[2], r[3]);
+		__m128i t2 = _mm_unpackhi_epi32(r[0], r[1]);
+		__m128i t3 = _mm_unpackhi_epi32(r[2], r[3]);
+		m[g * 4 + 0] = _mm_unpacklo_epi64(t0, t1);
+		m[g * 4 + 1] = _mm_unpackhi_epi64(t0, t1);
+		m[g * 4 + 2] = _mm_unpacklo_epi64(t2, t3);
+		m[g * 4 + 3] = _mm_unpackhi_epi64(t2, t3);
+	}
+}
+
+SSE41 void blake3_hash_chunks_sse41(uint8_t const *chunks, uint64_t counter, uint32_t *cvs) {
+	__m128i const rot16 = _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+	__m128i const rot8 = _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+	uint32_t low[16];
+	uint32_t high[16];
+	lane_counters(counter, 4, low, high);
+
+	__m128i h[8];
+	for (size_t i = 0; i < 8; i++) {
+		h[i] = _mm_set1_epi32((int)blake3_iv[i]);
+	}
+	for (size_t b = 0; b < 16; b++) {
+		__m128i m[16];
+		load_block_sse41(m, chunks, b);
+		uint8_t flags = (b == 0 ? BLAKE3_CHUNK_START : 0) | (b == 15 ? BLAKE3_CHUNK_END : 0);
+		__m128i v[16] = {
+			h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+			_mm_set1_epi32((int)blake3_iv[0]), _mm_set1_epi32((int)blake3_iv[1]),
+			_mm_set1_epi32((int)blake3_iv[2]), _mm_set1_epi32((int)blake3_iv[3]),
+			_mm_loadu_si128((__m128i const *)low), _mm_loadu_si128((__m128i const *)high),
+			_mm_set1_epi32(64), _mm_set1_epi32(flags),
+		};
+
+		BLAKE3_ROUNDS(G128, v, m)
+
+		for (size_t i = 0; i < 8; i++) {
+			h[i] = _mm_xor_si128(v[i], v[i + 8]);
+		}
+	}
+
+	_Alignas(16) uint32_t words[8 * 4];
+	for (size_t i = 0; i < 8; i++) {
+		_mm_store_si128((__m128i *)&words[i * 4], h[i]);
+	}
+	store_cvs(words, 4, cvs);
+}
+
+# define ROT16_256(x) _mm256_shuffle_epi8((x), rot16)
+# define ROT8_256(x) _mm256_shuffle_epi8((x), rot8)
+# define ROTN_256(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+
+# define G256(a, b, c, d, x, y) { \
+	(a) = _mm256_add_epi32(_mm256_add_epi32((a), (b)), (x)); \
+	(d) = ROT16_256(_mm256_xor_si256((d), (a))); \
+	(c) = _mm256_add_epi32((c), (d)); \
+	(b) = ROTN_256(_mm256_xor_si256((b), (c)), 12); \
+	(a) = _mm256_add_epi32(_mm256_add_epi32((a), (b)), (y)); \
+	(d) = ROT8_256(_mm256_xor_si256((d), (a))); \
+	(c) = _mm256_add_epi32((c), (d)); \
+	(b) = ROTN_256(_mm256_xor_si256((b), (c)), 7); \
+}
+
+AVX2 void blake3_hash_chunks_avx2(uint8_t const *chunks, uint64_t counter, uint32_t *cvs) {
+	__m256i const rot16 = _mm256_setr_epi8(
+		2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+		2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+	__m256i const rot8 = _mm256_setr_epi8(
+		1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+		1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+	// Word offsets of the start of each lane's chunk
+	__m256i const lane_offsets = _mm256_setr_epi32(0, 256, 512, 768, 1024, 1280, 1536, 1792);
+	uint32_t low[16];
+	uint32_t high[16];
+	lane_counters(counter, 8, low, high);
+
+	__m256i h[8];
+	for (size_t i = 0; i < 8; i++) {
+		h[i] = _mm256_set1_epi32((int)blake3_iv[i]);
+	}
+	for (size_t b = 0; b < 16; b++) {
+		__m256i m[16];
+		int const *block = (int const *)(chunks + b * 64);
+		for (size_t i = 0; i < 16; i++) {
+			m[i] = _mm256_i32gather_epi32(block + i, lane_offsets, 4);
+		}
+		uint8_t flags = (b == 0 ? BLAKE3_CHUNK_START : 0) | (b == 15 ? BLAKE3_CHUNK_END : 0);
+		__m256i v[16] = {
+			h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+			_mm256_set1_epi32((int)blake3_iv[0]), _mm256_set1_epi32((int)blake3_iv[1]),
+			_mm256_set1_epi32((int)blake3_iv[2]), _mm256_set1_epi32((int)blake3_iv[3]),
+			_mm256_loadu_si256((__m256i const *)low), _mm256_loadu_si256((__m256i const *)high),
+			_mm256_set1_epi32(64), _mm256_set1_epi32(flags),
+		};
+
+		BLAKE3_ROUNDS(G256, v, m)
+
+		for (size_t i = 0; i < 8; i++) {
+			h[i] = _mm256_xor_si256(v[i], v[i + 8]);
+		}
+	}
+
+	_Alignas(32) uint32_t words[8 * 8];
+	for (size_t i = 0; i < 8; i++) {
+		_mm256_store_si256((__m256i *)&words[i * 8], h[i]);
+	}
+	store_cvs(words, 8, cvs);
+}
+
+# define G512(a, b, c, d, x, y) { \
+	(a) = _mm512_add_epi32(_mm512_add_epi32((a), (b)), (x)); \
+	(d) = _mm512_ror_epi32(_mm512_xor_si512((d), (a)), 16); \
+	(c) = _mm512_add_epi32((c), (d)); \
+	(b) = _mm512_ror_epi32(_mm512_xor_si512((b), (c)), 12); \
+	(a) = _mm512_add_epi32(_mm512_add_epi32((a), (b)), (y)); \
+	(d) = _mm512_ror_epi32(_mm512_xor_si512((d), (a)), 8); \
+	(c) = _mm512_add_epi32((c), (d)); \
+	(b) = _mm512_ror_epi32(_mm512_xor_si512((b), (c)), 7); \
+}
+
+AVX512 void blake3_hash_chunks_avx512(uint8_t const *chunks, uint64_t counter, uint32_t *cvs) {
+	// Word offsets of the start of each lane's chunk
+	__m512i const lane_offsets = _mm512_mullo_epi32(
+		_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(256));
+	uint32_t low[16];
+	uint32_t high[16];
+	lane_counters(counter, 16, low, high);
+
+	__m512i h[8];
+	for (size_t i = 0; i < 8; i++) {
+		h[i] = _mm512_set1_epi32((int)blake3_iv[i]);
+	}
+	for (size_t b = 0; b < 16; b++) {
+		__m512i m[16];
+		uint8_t const *block = chunks + b * 64;
+		for (size_t i = 0; i < 16; i++) {
+			m[i] = _mm512_i32gather_epi32(lane_offsets, block + i * 4, 4);
+		}
+		uint8_t flags = (b == 0 ? BLAKE3_CHUNK_START : 0) | (b == 15 ? BLAKE3_CHUNK_END : 0);
+		__m512i v[16] = {
+			h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+			_mm512_set1_epi32((int)blake3_iv[0]), _mm512_set1_epi32((int)blake3_iv[1]),
+			_mm512_set1_epi32((int)blake3_iv[2]), _mm512_set1_epi32((int)blake3_iv[3]),
+			_mm512_loadu_si512(low), _mm512_loadu_si512(high),
+			_mm512_set1_epi32(64), _mm512_set1_epi32(flags),
+		};
+
+		BLAKE3_ROUNDS(G512, v, m)
+
+		for (size_t i = 0; i < 8; i++) {
+			h[i] = _mm512_xor_si512(v[i], v[i + 8]);
+		}
+	}
+
+	_Alignas(64) uint32_t words[8 * 16];
+	for (size_t i = 0; i < 8; i++) {
+		_mm512_store_si512(&words[i * 16], h[i]);
+	}
+	store_cvs(words, 16, cvs);
+}
+
+#else
+
+void blake3_hash_chunks_sse41(uint8_t const *chunks, uint64_t counter, uint32_t *cvs) {
+	blake3_hash_chunks_portable(chunks, counter, cvs);
+}
+
+void blake3_hash_chunks_avx2(uint8_t const *chunks, uint64_t counter, uint32_t *cvs) {
+	blake3_hash_chunks_portable(chunks, counter, cvs);
+}
+
+void blake3_hash_chunks_avx512(uint8_t const *chunks, uint64_t counter, uint32_t *cvs) {
+	blake3_hash_chunks_portable(chunks, counter, cvs);
+}
+
+#endif
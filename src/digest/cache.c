@@ -0,0 +1,441 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "utils.h"
+
+// The file is a header, an open-addressing index of `slot_count` slots, then the records, appended one after the other
+// A slot holds the offset of its record in the low 48 bits and a tag from the key's hash in the high 16, 0 is empty
+// Records are written before the slot that points to them, and carry a checksum, so a torn append is never returned
+// Everything is in the byte order of the host
+// The index is rebuilt twice as large into a new file, renamed over the old one, once it is three quarters full
+
+#define CACHE_MAGIC "FTSSLDC1"
+#define CACHE_VERSION 1
+
+#ifndef CACHE_INITIAL_SLOTS
+# define CACHE_INITIAL_SLOTS 4096
+#endif
+
+#define SLOT_OFFSET_BITS 48
+#define SLOT_OFFSET_MASK ((UINT64_C(1) << SLOT_OFFSET_BITS) - 1)
+
+struct cache_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_bytes;
+	uint64_t slot_count; // a power of 2
+	uint64_t record_count;
+	uint8_t reserved[32];
+};
+
+struct cache_record {
+	struct cache_key key;
+	uint8_t hash_len;
+	uint8_t reserved[7];
+	uint8_t hash[CACHE_MAX_HASH_BYTES];
+	uint64_t checksum; // of everything before it
+};
+
+_Static_assert(sizeof(struct cache_header) == 64, "cache header layout");
+_Static_assert(sizeof(struct cache_key) == 48, "cache key layout");
+_Static_assert(sizeof(struct cache_record) == 128, "cache record layout");
+
+struct digest_cache {
+	pthread_rwlock_t lock; // stores and remapping exclude lookups
+	char *path;
+	int fd;
+	dev_t dev; // of the file behind `fd`, to notice when another process replaced it
+	ino_t ino;
+	struct cache_header *map; // the header and the index
+	size_t map_size;
+};
+
+struct cache_key cache_key(struct stat const *st, uint32_t algorithm, uint64_t variant) {
+	return (struct cache_key){
+		.dev = st->st_dev,
+		.ino = st->st_ino,
+		.size = st->st_size,
+		.mtime_sec = st->st_mtim.tv_sec,
+		.mtime_nsec = st->st_mtim.tv_nsec,
+		.algorithm = algorithm,
+		.variant = variant,
+	};
+}
+
+static uint64_t mix64(uint64_t x) {
+	x ^= x >> 30;
+	x *= UINT64_C(0xbf58476d1ce4e5b9);
+	x ^= x >> 27;
+	x *= UINT64_C(0x94d049bb133111eb);
+	x ^= x >> 31;
+	return x;
+}
+
+static uint64_t key_hash(struct cache_key const *key) {
+	uint64_t words[sizeof(*key) / 8];
+	ft_memcpy(words, key, sizeof(*key));
+	uint64_t hash = 0;
+	for (size_t i = 0; i < sizeof(words) / sizeof(*words); i++) {
+		hash = mix64(hash ^ words[i]);
+	}
+	return hash;
+}
+
+/// FNV-1a
+static uint64_t record_checksum(struct cache_record const *record) {
+	uint8_t const *bytes = (uint8_t const *)record;
+	uint64_t hash = UINT64_C(0xcbf29ce484222325);
+	for (size_t i = 0; i < offsetof(struct cache_record, checksum); i++) {
+		hash = (hash ^ bytes[i]) * UINT64_C(0x100000001b3);
+	}
+	return hash;
+}
+
+static off_t records_start(uint64_t slot_count) {
+	return sizeof(struct cache_header) + slot_count * sizeof(uint64_t);
+}
+
+static uint64_t *cache_slots(struct cache_header *header) {
+	return (uint64_t *)(header + 1);
+}
+
+static bool read_record(int fd, off_t offset, struct cache_record *record) {
+	return ft_pread_full(fd, record, sizeof(*record), offset) == sizeof(*record) && record->checksum == record_checksum(record);
+}
+
+/// Looks for `key` in the index of `header`, the records being in `fd`
+/// Returns true when it is there, otherwise `slot` is set to the empty slot it would go in (or SIZE_MAX when full)
+static bool find_slot(int fd, struct cache_header *header, struct cache_key const *key, size_t *slot, struct cache_record *record) {
+	uint64_t *slots = cache_slots(header);
+	uint64_t mask = header->slot_count - 1;
+	uint64_t hash = key_hash(key);
+	uint64_t tag = hash >> SLOT_OFFSET_BITS;
+
+	*slot = SIZE_MAX;
+	for (uint64_t i = 0, index = hash & mask; i <= mask; i++, index = (index + 1) & mask) {
+		uint64_t value = __atomic_load_n(&slots[index], __ATOMIC_ACQUIRE);
+		if (value == 0) {
+			*slot = index;
+			return false;
+		}
+		if (
+			value >> SLOT_OFFSET_BITS == tag &&
+			read_record(fd, value & SLOT_OFFSET_MASK, record) &&
+			memcmp(&record->key, key, sizeof(*key)) == 0
+		) {
+			*slot = index;
+			return true;
+		}
+	}
+	return false;
+}
+
+/// Appends `record` and publishes it in the slot `slot`, which must be empty
+static bool append_record(int fd, struct cache_header *header, size_t slot, struct cache_record const *record) {
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		return false;
+	}
+	// After a torn append, the next record starts on the next boundary again
+	off_t start = records_start(header->slot_count);
+	off_t offset = st.st_size < start ? start : st.st_size;
+	offset += (sizeof(*record) - (offset - start) % sizeof(*record)) % sizeof(*record);
+	if ((uint64_t)offset > SLOT_OFFSET_MASK || pwrite(fd, record, sizeof(*record), offset) != sizeof(*record)) {
+		return false;
+	}
+
+	uint64_t tag = key_hash(&record->key) >> SLOT_OFFSET_BITS;
+	__atomic_store_n(&cache_slots(header)[slot], tag << SLOT_OFFSET_BITS | (uint64_t)offset, __ATOMIC_RELEASE);
+	header->record_count++;
+	return true;
+}
+
+/// Writes the header and an empty index of `slot_count` slots to the empty file `fd`
+/// The header goes first, a file cut short after it is recognized as a damaged cache file
+static bool init_cache_file(int fd, uint64_t slot_count) {
+	struct cache_header header = {
+		.version = CACHE_VERSION,
+		.record_bytes = sizeof(struct cache_record),
+		.slot_count = slot_count,
+		.record_count = 0,
+	};
+	ft_memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+	return pwrite(fd, &header, sizeof(header), 0) == sizeof(header) && ftruncate(fd, records_start(slot_count)) == 0;
+}
+
+/// Checks the header of `fd` and maps it together with the index
+/// Returns false with errno set on failure, EINVAL when `fd` isn't a cache file
+static bool map_cache_file(int fd, struct cache_header **map, size_t *map_size) {
+	struct cache_header header;
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		return false;
+	}
+	if (
+		ft_pread_full(fd, &header, sizeof(header), 0) != sizeof(header) ||
+		memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != CACHE_VERSION ||
+		header.record_bytes != sizeof(struct cache_record) ||
+		header.slot_count == 0 ||
+		(header.slot_count & (header.slot_count - 1)) != 0 ||
+		header.slot_count > (SLOT_OFFSET_MASK - sizeof(header)) / sizeof(uint64_t) ||
+		st.st_size < records_start(header.slot_count)
+	) {
+		errno = EINVAL;
+		return false;
+	}
+
+	*map_size = records_start(header.slot_count);
+	*map = mmap(NULL, *map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	return *map != MAP_FAILED;
+}
+
+/// Makes `fd`, already locked, the file of `cache` instead of the current one
+static bool switch_cache_file(struct digest_cache *cache, int fd) {
+	struct cache_header *map;
+	size_t map_size;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !map_cache_file(fd, &map, &map_size)) {
+		return false;
+	}
+	munmap(cache->map, cache->map_size);
+	close(cache->fd);
+	cache->fd = fd;
+	cache->dev = st.st_dev;
+	cache->ino = st.st_ino;
+	cache->map = map;
+	cache->map_size = map_size;
+	return true;
+}
+
+/// Path of the file a new cache file is written to before it is renamed over `path`
+static char *tmp_cache_path(char const *path) {
+	size_t path_len = ft_strlen(path);
+	char *tmp_path = malloc(path_len + sizeof(".tmp"));
+	if (tmp_path != NULL) {
+		ft_memcpy(tmp_path, path, path_len);
+		ft_memcpy(tmp_path + path_len, ".tmp", sizeof(".tmp"));
+	}
+	return tmp_path;
+}
+
+/// Copies the valid records into a new file with twice the slots, which then replaces the current one
+/// The current file must be locked, the new one is locked before it becomes visible
+static bool rebuild_cache(struct digest_cache *cache) {
+	char *tmp_path = tmp_cache_path(cache->path);
+	if (tmp_path == NULL) {
+		return false;
+	}
+
+	struct cache_header *map = NULL;
+	size_t map_size = 0;
+	bool done = false;
+	int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (
+		fd < 0 ||
+		flock(fd, LOCK_EX) != 0 ||
+		!init_cache_file(fd, cache->map->slot_count * 2) ||
+		!map_cache_file(fd, &map, &map_size)
+	) {
+		goto cleanup;
+	}
+
+	struct stat st;
+	if (fstat(cache->fd, &st) != 0) {
+		goto cleanup;
+	}
+	struct cache_record record;
+	struct cache_record existing;
+	for (off_t offset = records_start(cache->map->slot_count); offset + (off_t)sizeof(record) <= st.st_size; offset += sizeof(record)) {
+		size_t slot;
+		if (
+			read_record(cache->fd, offset, &record) &&
+			!find_slot(fd, map, &record.key, &slot, &existing) &&
+			slot != SIZE_MAX &&
+			!append_record(fd, map, slot, &record)
+		) {
+			goto cleanup;
+		}
+	}
+	if (fsync(fd) != 0 || rename(tmp_path, cache->path) != 0) {
+		goto cleanup;
+	}
+
+	munmap(map, map_size);
+	map = NULL;
+	done = switch_cache_file(cache, fd);
+	if (done) {
+		fd = -1;
+	}
+
+cleanup:
+	if (map != NULL) {
+		munmap(map, map_size);
+	}
+	if (fd >= 0) {
+		if (!done) {
+			unlink(tmp_path);
+		}
+		close(fd);
+	}
+	free(tmp_path);
+	return done;
+}
+
+/// Whether the `size` bytes of `fd` start like a cache file, so that it is one that was truncated or damaged
+/// Anything else is left alone, in case the path was a mistake
+static bool is_damaged_cache_file(int fd, off_t size) {
+	char magic[sizeof(CACHE_MAGIC) - 1];
+	size_t len = size < (off_t)sizeof(magic) ? (size_t)size : sizeof(magic);
+	return len > 0 && ft_pread_full(fd, magic, len, 0) == (ssize_t)len && memcmp(magic, CACHE_MAGIC, len) == 0;
+}
+
+/// Replaces the cache file at `path` with an empty one, returns its descriptor, locked, or -1
+/// The new file is renamed over the old one, processes that still have the old one mapped never see it shrink
+static int reset_cache_file(char const *path) {
+	char *tmp_path = tmp_cache_path(path);
+	if (tmp_path == NULL) {
+		return -1;
+	}
+	int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd >= 0 && (flock(fd, LOCK_EX) != 0 || !init_cache_file(fd, CACHE_INITIAL_SLOTS) || rename(tmp_path, path) != 0)) {
+		int saved_errno = errno;
+		unlink(tmp_path);
+		close(fd);
+		errno = saved_errno;
+		fd = -1;
+	}
+	free(tmp_path);
+	return fd;
+}
+
+/// Switches to the file at the path when another process replaced it, `cache->fd` is locked before and after
+static void follow_cache_file(struct digest_cache *cache) {
+	struct stat st;
+	if (stat(cache->path, &st) != 0 || (st.st_dev == cache->dev && st.st_ino == cache->ino)) {
+		return;
+	}
+	int fd = open(cache->path, O_RDWR | O_CLOEXEC);
+	if (fd < 0) {
+		return;
+	}
+	if (flock(fd, LOCK_EX) != 0 || !switch_cache_file(cache, fd)) {
+		close(fd);
+	}
+}
+
+t_result cache_open(struct digest_cache **cache_ptr, char const *path) {
+	struct digest_cache *cache = malloc(sizeof(*cache));
+	size_t path_len = ft_strlen(path);
+	char *path_copy = malloc(path_len + 1);
+	int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	struct stat st;
+
+	if (cache == NULL || path_copy == NULL || fd < 0 || flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0) {
+		goto fail;
+	}
+	if (st.st_size == 0 && !init_cache_file(fd, CACHE_INITIAL_SLOTS)) {
+		goto fail;
+	}
+	struct cache_header *map;
+	size_t map_size;
+	if (!map_cache_file(fd, &map, &map_size)) {
+		// The hashes are lost, they are computed again and stored in the new file
+		if (errno != EINVAL || !is_damaged_cache_file(fd, st.st_size)) {
+			goto fail;
+		}
+		int new_fd = reset_cache_file(path);
+		if (new_fd < 0) {
+			goto fail;
+		}
+		close(fd);
+		fd = new_fd;
+		if (fstat(fd, &st) != 0 || !map_cache_file(fd, &map, &map_size)) {
+			goto fail;
+		}
+	}
+	*cache = (struct digest_cache){
+		.lock = PTHREAD_RWLOCK_INITIALIZER,
+		.path = path_copy,
+		.fd = fd,
+		.dev = st.st_dev,
+		.ino = st.st_ino,
+		.map = map,
+		.map_size = map_size,
+	};
+	ft_memcpy(path_copy, path, path_len + 1);
+	flock(fd, LOCK_UN);
+	*cache_ptr = cache;
+	return OK;
+
+fail:
+	set_err_object(path);
+	t_result result = errno == EINVAL
+		? set_error(E_INVALID_OPT_VALUE, "Not a digest cache file")
+		: set_error(E_ERRNO, "");
+	if (fd >= 0) {
+		close(fd);
+	}
+	free(path_copy);
+	free(cache);
+	return result;
+}
+
+bool cache_lookup(struct digest_cache *cache, struct cache_key const *key, uint8_t *hash, size_t hash_len) {
+	pthread_rwlock_rdlock(&cache->lock);
+	size_t slot;
+	struct cache_record record;
+	bool found = find_slot(cache->fd, cache->map, key, &slot, &record) && record.hash_len == hash_len;
+	if (found) {
+		ft_memcpy(hash, record.hash, hash_len);
+	}
+	pthread_rwlock_unlock(&cache->lock);
+	return found;
+}
+
+void cache_store(struct digest_cache *cache, struct cache_key const *key, uint8_t const *hash, size_t hash_len) {
+	if (hash_len > CACHE_MAX_HASH_BYTES) {
+		return;
+	}
+	int saved_errno = errno;
+	struct cache_record record;
+	memset(&record, 0, sizeof(record));
+	record.key = *key;
+	record.hash_len = hash_len;
+	ft_memcpy(record.hash, hash, hash_len);
+	record.checksum = record_checksum(&record);
+
+	pthread_rwlock_wrlock(&cache->lock);
+	if (flock(cache->fd, LOCK_EX) == 0) {
+		follow_cache_file(cache);
+
+		size_t slot;
+		struct cache_record existing;
+		if (!find_slot(cache->fd, cache->map, key, &slot, &existing)) {
+			if ((cache->map->record_count + 1) * 4 > cache->map->slot_count * 3 && rebuild_cache(cache)) {
+				find_slot(cache->fd, cache->map, key, &slot, &existing);
+			}
+			if (slot != SIZE_MAX) {
+				append_record(cache->fd, cache->map, slot, &record);
+			}
+		}
+		flock(cache->fd, LOCK_UN);
+	}
+	pthread_rwlock_unlock(&cache->lock);
+	errno = saved_errno;
+}
+
+void cache_close(struct digest_cache *cache) {
+	munmap(cache->map, cache->map_size);
+	close(cache->fd);
+	pthread_rwlock_destroy(&cache->lock);
+	free(cache->path);
+	free(cache);
+}
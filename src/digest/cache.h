@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "error.h"
+
+/// Largest hash the cache holds, in bytes
+#define CACHE_MAX_HASH_BYTES 64
+
+/// A file's contents are assumed unchanged while its device, inode, size and modification time are
+struct cache_key {
+	uint64_t dev;
+	uint64_t ino;
+	uint64_t size;
+	int64_t mtime_sec;
+	uint32_t mtime_nsec;
+	uint32_t algorithm;
+	uint64_t variant; // anything else the hash depends on, like the leaf size of a tree hash
+};
+
+struct digest_cache;
+
+struct cache_key cache_key(struct stat const *st, uint32_t algorithm, uint64_t variant);
+
+/// Opens the cache file at `path`, creating it when it doesn't exist, or starting it over when it is damaged
+/// Files that aren't cache files are an error
+t_result cache_open(struct digest_cache **cache, char const *path);
+
+/// Copies the cached hash of `key` to `hash`, returns false when there is none
+/// Safe to call from any thread, this does not touch the error state
+bool cache_lookup(struct digest_cache *cache, struct cache_key const *key, uint8_t *hash, size_t hash_len);
+
+/// Adds the hash of `key`, failures only mean it won't be found next time
+/// Safe to call from any thread, this does not touch the error state
+void cache_store(struct digest_cache *cache, struct cache_key const *key, uint8_t const *hash, size_t hash_len);
+
+void cache_close(struct digest_cache *cache);
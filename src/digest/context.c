@@ -0,0 +1,109 @@
+#include <stdbool.h>
+
+#include "context.h"
+#include "utils.h"
+
+/// Completes the partial block in `block` with the start of `*m`, returns true when it holds a whole block
+/// Does nothing when there is no partial block, so `*m` can go straight to the rounds
+static bool fill_block(uint8_t block[64], size_t *used, uint8_t const **m, size_t *len) {
+	if (*used == 0) {
+		return false;
+	}
+	size_t take = 64 - *used < *len ? 64 - *used : *len;
+	ft_memcpy(block + *used, *m, take);
+	*used += take;
+	*m += take;
+	*len -= take;
+	if (*used < 64) {
+		return false;
+	}
+	*used = 0;
+	return true;
+}
+
+/// Keeps the last `len` bytes of an update, less than a block, for the next update or the final round
+static void keep_tail(uint8_t block[64], size_t *used, uint8_t const *m, size_t len) {
+	ft_memcpy(block + *used, m, len);
+	*used += len;
+}
+
+void md5_init(struct md5_ctx *ctx) {
+	ctx->state = md5_state();
+	ctx->used = 0;
+}
+
+void md5_update(struct md5_ctx *ctx, void const *data, size_t len) {
+	uint8_t const *m = data;
+	if (fill_block(ctx->block, &ctx->used, &m, &len)) {
+		md5_rounds(&ctx->state, ctx->block, 1);
+	}
+	size_t blocks = len / 64;
+	md5_rounds(&ctx->state, m, blocks);
+	keep_tail(ctx->block, &ctx->used, m + blocks * 64, len % 64);
+}
+
+void md5_final(struct md5_ctx *ctx, struct hash128 *hash) {
+	*hash = md5_final_round(ctx->state, ctx->block, ctx->used * 8);
+}
+
+void md5_clone(struct md5_ctx *dst, struct md5_ctx const *src) {
+	*dst = *src;
+}
+
+void md5_reset(struct md5_ctx *ctx) {
+	md5_init(ctx);
+}
+
+void sha256_init(struct sha256_ctx *ctx) {
+	ctx->state = sha256_state();
+	ctx->used = 0;
+}
+
+void sha256_update(struct sha256_ctx *ctx, void const *data, size_t len) {
+	uint8_t const *m = data;
+	if (fill_block(ctx->block, &ctx->used, &m, &len)) {
+		sha256_rounds(&ctx->state, ctx->block, 1);
+	}
+	size_t blocks = len / 64;
+	sha256_rounds(&ctx->state, m, blocks);
+	keep_tail(ctx->block, &ctx->used, m + blocks * 64, len % 64);
+}
+
+void sha256_final(struct sha256_ctx *ctx, struct hash256 *hash) {
+	*hash = sha256_final_round(ctx->state, ctx->block, ctx->used * 8);
+}
+
+void sha256_clone(struct sha256_ctx *dst, struct sha256_ctx const *src) {
+	*dst = *src;
+}
+
+void sha256_reset(struct sha256_ctx *ctx) {
+	sha256_init(ctx);
+}
+
+void whirlpool_init(struct whirlpool_ctx *ctx) {
+	ctx->state = whirlpool_state();
+	ctx->used = 0;
+}
+
+void whirlpool_update(struct whirlpool_ctx *ctx, void const *data, size_t len) {
+	uint8_t const *m = data;
+	if (fill_block(ctx->block, &ctx->used, &m, &len)) {
+		whirlpool_rounds(&ctx->state, ctx->block, 1);
+	}
+	size_t blocks = len / 64;
+	whirlpool_rounds(&ctx->state, m, blocks);
+	keep_tail(ctx->block, &ctx->used, m + blocks * 64, len % 64);
+}
+
+void whirlpool_final(struct whirlpool_ctx *ctx, struct hash512 *hash) {
+	*hash = whirlpool_final_round(ctx->state, ctx->block, ctx->used * 8);
+}
+
+void whirlpool_clone(struct whirlpool_ctx *dst, struct whirlpool_ctx const *src) {
+	*dst = *src;
+}
+
+void whirlpool_reset(struct whirlpool_ctx *ctx) {
+	whirlpool_init(ctx);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash.h"
+#include "md5.h"
+#include "sha256.h"
+#include "whirlpool.h"
+
+// Streaming contexts for embedding the hashes in other programs, built into libft_ssl.a
+// `*_update` accepts any amount of bytes and keeps a partial block until the next call or `*_final`
+// A context is a plain value: `*_clone` forks a hash of a common prefix and `*_reset` reuses the context
+
+struct md5_ctx {
+	struct md5_state state;
+	size_t used;
+	uint8_t block[64];
+};
+
+void md5_init(struct md5_ctx *ctx);
+void md5_update(struct md5_ctx *ctx, void const *data, size_t len);
+/// The context has to be reset before it is updated again
+void md5_final(struct md5_ctx *ctx, struct hash128 *hash);
+void md5_clone(struct md5_ctx *dst, struct md5_ctx const *src);
+void md5_reset(struct md5_ctx *ctx);
+
+struct sha256_ctx {
+	struct sha256_state state;
+	size_t used;
+	uint8_t block[64];
+};
+
+void sha256_init(struct sha256_ctx *ctx);
+void sha256_update(struct sha256_ctx *ctx, void const *data, size_t len);
+/// The context has to be reset before it is updated again
+void sha256_final(struct sha256_ctx *ctx, struct hash256 *hash);
+void sha256_clone(struct sha256_ctx *dst, struct sha256_ctx const *src);
+void sha256_reset(struct sha256_ctx *ctx);
+
+struct whirlpool_ctx {
+	struct whirlpool_state state;
+	size_t used;
+	uint8_t block[64];
+};
+
+void whirlpool_init(struct whirlpool_ctx *ctx);
+void whirlpool_update(struct whirlpool_ctx *ctx, void const *data, size_t len);
+/// The context has to be reset before it is updated again
+void whirlpool_final(struct whirlpool_ctx *ctx, struct hash512 *hash);
+void whirlpool_clone(struct whirlpool_ctx *dst, struct whirlpool_ctx const *src);
+void whirlpool_reset(struct whirlpool_ctx *ctx);
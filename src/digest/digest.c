@@ -1,16 +1,76 @@
 #include <fcntl.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "blake3.h"
+#include "cache.h"
 #include "error.h"
 #include "md5.h"
+#include "multibuffer.h"
+#include "output.h"
+#include "pipeline.h"
+#include "pool.h"
 #include "sha256.h"
+#include "sha512.h"
+#include "uring.h"
 #include "utils.h"
+#include "walk.h"
 #include "whirlpool.h"
 
-#define DIGEST_BLOCK_SIZE 512
-#define DIGEST_BLOCK_BYTES (DIGEST_BLOCK_SIZE / 8)
+/// The largest block of all digests, the others divide it
+#define DIGEST_MAX_BLOCK_BYTES 128
+
+/// Amount of bytes read per syscall, must be a multiple of `DIGEST_MAX_BLOCK_BYTES`
+#ifndef DIGEST_STREAM_BYTES
+# define DIGEST_STREAM_BYTES (256 * 1024)
+#endif
+
+/// Amount of mapped bytes hashed between checkpoints, must be a multiple of `DIGEST_MAX_BLOCK_BYTES`
+#ifndef DIGEST_MMAP_WINDOW
+# define DIGEST_MMAP_WINDOW (4 * 1024 * 1024)
+#endif
+
+/// Amount of buffers a pipe can be read ahead of the hashing
+#ifndef DIGEST_PIPELINE_SLOTS
+# define DIGEST_PIPELINE_SLOTS 4
+#endif
+
+/// Amount of files read at the same time with `-uring`
+#ifndef DIGEST_URING_DEPTH
+# define DIGEST_URING_DEPTH 64
+#endif
+
+/// Files up to this size are hashed side by side through a multi-buffer kernel, when the cpu has one
+#ifndef DIGEST_MB_MAX_BYTES
+# define DIGEST_MB_MAX_BYTES (64 * 1024)
+#endif
+
+/// Without `-j`, files are hashed one after the other unless at least this many are small enough for the multi-buffer kernel
+#ifndef DIGEST_MB_MIN_FILES
+# define DIGEST_MB_MIN_FILES 2
+#endif
+
+/// Amount of small file data read into memory before it is hashed through the multi-buffer kernel
+#ifndef DIGEST_MB_BATCH_BYTES
+# define DIGEST_MB_BATCH_BYTES (4 * 1024 * 1024)
+#endif
+
+/// Amount of files hashed at the same time with `-c` or `-R`, their names are kept until the batch is done
+#ifndef DIGEST_FILE_BATCH
+# define DIGEST_FILE_BATCH 4096
+#endif
+
+/// Files from this size on are split into subtrees hashed on all threads, for the digests that are trees
+#ifndef DIGEST_TREE_MIN_BYTES
+# define DIGEST_TREE_MIN_BYTES (4 * 1024 * 1024)
+#endif
 
 struct digest_args {
 	char **files;
@@ -19,24 +79,49 @@ struct digest_args {
 	bool print;
 	bool quiet;
 	bool reverse;
+	size_t jobs;
+	bool unordered;
+	bool uring;
+	size_t tree_chunk; // 0 when not hashing as a tree
+	bool leaves;
+	char const *check; // manifest to verify, "-" for stdin
+	char const *cache_path;
+	struct digest_cache *cache; // opened from `cache_path` once the arguments are valid
+	bool recursive;
+	bool follow_links;
+	bool one_filesystem;
+	bool read_failed; // a file couldn't be read, it was reported and skipped
 };
 
+/// The values are stored in digest caches, new digests go at the end
 enum e_digest {
 	D_MD5,
 	D_SHA256,
 	D_WHIRLPOOL,
+	D_SHA384,
+	D_SHA512,
+	D_SHA512_256,
+	D_BLAKE3,
 };
 
+#define DIGEST_COUNT (D_BLAKE3 + 1)
+
 typedef union {
 	struct md5_state md5_state;
 	struct sha256_state sha256_state;
 	struct whirlpool_state whirlpool_state;
+	struct sha512_state sha512_state; // also SHA-384 and SHA-512/256
+	struct blake3_state blake3_state;
 } t_digest_state;
 
 typedef union {
 	struct hash128 md5;
 	struct hash256 sha256;
 	struct hash512 whirlpool;
+	struct hash384 sha384;
+	struct hash512 sha512;
+	struct hash256 sha512_256;
+	struct hash256 blake3;
 } t_digest_hash;
 
 static t_digest_state digest_state(enum e_digest digest) {
@@ -52,6 +137,32 @@ static t_digest_state digest_state(enum e_digest digest) {
 		case D_WHIRLPOOL:
 			state.whirlpool_state = whirlpool_state();
 			return state;
+		case D_SHA384:
+			state.sha512_state = sha384_state();
+			return state;
+		case D_SHA512:
+			state.sha512_state = sha512_state();
+			return state;
+		case D_SHA512_256:
+			state.sha512_state = sha512_256_state();
+			return state;
+		case D_BLAKE3:
+			state.blake3_state = blake3_state();
+			return state;
+	}
+}
+
+static size_t digest_block_bytes(enum e_digest digest) {
+	switch (digest) {
+		case D_MD5:
+		case D_SHA256:
+		case D_WHIRLPOOL:
+		case D_BLAKE3:
+			return 64;
+		case D_SHA384:
+		case D_SHA512:
+		case D_SHA512_256:
+			return 128;
 	}
 }
 
@@ -63,7 +174,20 @@ static t_result parse_digest_args(char **args, struct digest_args *opts) {
 		.quiet = false,
 		.reverse = false,
 		.string = NULL,
+		.jobs = 1,
+		.unordered = false,
+		.uring = false,
+		.tree_chunk = 0,
+		.leaves = false,
+		.check = NULL,
+		.cache_path = NULL,
+		.cache = NULL,
+		.recursive = false,
+		.follow_links = false,
+		.one_filesystem = false,
+		.read_failed = false,
 	};
+	char const *walk_opt = NULL; // the last option that only makes sense with -R
 
 	size_t index = 0;
 	while (args[index] != NULL && args[index][0] == '-') {
@@ -89,12 +213,97 @@ static t_result parse_digest_args(char **args, struct digest_args *opts) {
 			}
 			opts->string = args[index];
 		}
+		else if (ft_streq(&arg[1], "j")) {
+			index++;
+			if (args[index] == NULL) {
+				set_err_object(arg);
+				return set_error(E_OPT_MISSING_VALUE, "Option expected value, but it is missing");
+			}
+			if (!ft_parse_size(args[index], &opts->jobs)) {
+				set_err_object(arg);
+				return set_error(E_INVALID_OPT_VALUE, "Option expected a number");
+			}
+			if (opts->jobs == 0) {
+				opts->jobs = pool_default_threads();
+			}
+		}
+		else if (ft_streq(&arg[1], "unordered")) {
+			opts->unordered = true;
+		}
+		else if (ft_streq(&arg[1], "uring")) {
+			opts->uring = true;
+		}
+		else if (ft_streq(&arg[1], "tree")) {
+			index++;
+			if (args[index] == NULL) {
+				set_err_object(arg);
+				return set_error(E_OPT_MISSING_VALUE, "Option expected value, but it is missing");
+			}
+			if (!ft_parse_bytes(args[index], &opts->tree_chunk) || opts->tree_chunk == 0) {
+				set_err_object(arg);
+				return set_error(E_INVALID_OPT_VALUE, "Option expected a size");
+			}
+		}
+		else if (ft_streq(&arg[1], "leaves")) {
+			opts->leaves = true;
+		}
+		else if (ft_streq(&arg[1], "cache")) {
+			index++;
+			if (opts->cache_path != NULL) {
+				set_err_object(arg);
+				return set_error(E_DUPLICATE_OPT, "Duplicate option");
+			}
+			if (args[index] == NULL) {
+				set_err_object(arg);
+				return set_error(E_OPT_MISSING_VALUE, "Option expected value, but it is missing");
+			}
+			opts->cache_path = args[index];
+		}
+		else if (ft_streq(&arg[1], "c")) {
+			index++;
+			if (opts->check != NULL) {
+				set_err_object(arg);
+				return set_error(E_DUPLICATE_OPT, "Duplicate option");
+			}
+			if (args[index] == NULL) {
+				set_err_object(arg);
+				return set_error(E_OPT_MISSING_VALUE, "Option expected value, but it is missing");
+			}
+			opts->check = args[index];
+		}
+		else if (ft_streq(&arg[1], "R")) {
+			opts->recursive = true;
+		}
+		else if (ft_streq(&arg[1], "L") || ft_streq(&arg[1], "P")) {
+			opts->follow_links = arg[1] == 'L';
+			walk_opt = arg;
+		}
+		else if (ft_streq(&arg[1], "x")) {
+			opts->one_filesystem = true;
+			walk_opt = arg;
+		}
 		else {
 			set_err_object(arg);
 			return set_error(E_UNEXPECTED_OPT, "Unexpected option");
 		}
 		index++;
 	}
+	if (opts->tree_chunk != 0 && opts->print) {
+		set_err_object("-p");
+		return set_error(E_UNEXPECTED_OPT, "Option can't be combined with -tree");
+	}
+	if (opts->tree_chunk == 0 && opts->leaves) {
+		set_err_object("-leaves");
+		return set_error(E_UNEXPECTED_OPT, "Option needs -tree");
+	}
+	if (!opts->recursive && walk_opt != NULL) {
+		set_err_object(walk_opt);
+		return set_error(E_UNEXPECTED_OPT, "Option needs -R");
+	}
+	if (opts->recursive && opts->check != NULL) {
+		set_err_object("-R");
+		return set_error(E_UNEXPECTED_OPT, "Option can't be combined with -c");
+	}
 	while (args[index] != NULL) {
 		while (args[index + opts->file_num] != NULL) {
 			opts->file_num++;
@@ -102,50 +311,102 @@ static t_result parse_digest_args(char **args, struct digest_args *opts) {
 		opts->files = &args[index];
 		index += opts->file_num;
 	}
+	if (opts->check != NULL && (opts->print || opts->string != NULL || opts->file_num > 0)) {
+		set_err_object("-c");
+		return set_error(E_UNEXPECTED_OPT, "Option can't be combined with -p, -s or files, they are listed in the manifest");
+	}
 
 	return OK;
 }
 
 struct digest_file_stream {
 	int fd;
-	uint8_t buffer[DIGEST_BLOCK_BYTES];
+	uint8_t *buffer;
+	size_t buffer_size;
+	struct pipeline *pipeline; // when set, a separate thread fills the buffers
 };
 
+static pthread_key_t stream_buffer_key;
+static pthread_once_t stream_buffer_once = PTHREAD_ONCE_INIT;
+
+static void create_stream_buffer_key(void) {
+	pthread_key_create(&stream_buffer_key, &free);
+}
+
+/// Every thread gets one read buffer, which is reused for all files it hashes
+static uint8_t *stream_buffer(void) {
+	pthread_once(&stream_buffer_once, &create_stream_buffer_key);
+	uint8_t *buffer = pthread_getspecific(stream_buffer_key);
+	if (buffer == NULL) {
+		buffer = malloc(DIGEST_STREAM_BYTES);
+		if (buffer != NULL && pthread_setspecific(stream_buffer_key, buffer) != 0) {
+			free(buffer);
+			buffer = NULL;
+		}
+	}
+	return buffer;
+}
+
+/// Pipes and sockets are read on a separate thread, so reading and hashing overlap
 static struct digest_file_stream file_stream(int fd) {
 	struct digest_file_stream stream = {
 		.fd = fd,
+		.buffer = NULL,
+		.buffer_size = DIGEST_STREAM_BYTES,
+		.pipeline = NULL,
 	};
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode))) {
+		if (pipeline_start(&stream.pipeline, fd, DIGEST_PIPELINE_SLOTS, DIGEST_STREAM_BYTES)) {
+			return stream;
+		}
+		stream.pipeline = NULL;
+	}
+	stream.buffer = stream_buffer();
 	return stream;
 }
 
-static ssize_t read_file_block(struct digest_file_stream *stream) {
-	int fd = stream->fd;
-	uint8_t *buffer = stream->buffer;
+/// Must only be called once everything has been read, or reading failed
+static void file_stream_finish(struct digest_file_stream *stream) {
+	if (stream->pipeline != NULL) {
+		pipeline_finish(stream->pipeline);
+		stream->pipeline = NULL;
+	}
+}
 
-	size_t buffer_filled = 0;
-	ssize_t nread = read(fd, buffer, sizeof(stream->buffer));
-	while (nread > 0) {
-		buffer_filled += nread;
-		nread = read(fd, buffer, sizeof(stream->buffer) - buffer_filled);
-	};
-	return buffer_filled;
+/// Fills the buffer of `stream` completely, unless the end of the file is reached
+static ssize_t read_file_blocks(struct digest_file_stream *stream) {
+	if (stream->pipeline != NULL) {
+		return pipeline_next(stream->pipeline, &stream->buffer);
+	}
+	return ft_read_full(stream->fd, stream->buffer, stream->buffer_size);
 }
 
-static t_digest_state digest_round(enum e_digest digest, t_digest_state state, const uint8_t m[DIGEST_BLOCK_BYTES]) {
+static void digest_rounds(enum e_digest digest, t_digest_state *state, uint8_t const *m, size_t blocks) {
 	switch (digest) {
 		case D_MD5:
-			state.md5_state = md5_round(state.md5_state, m);
-			return state;
+			md5_rounds(&state->md5_state, m, blocks);
+			return;
 		case D_SHA256:
-			state.sha256_state = sha256_round(state.sha256_state, m);
-			return state;
+			sha256_rounds(&state->sha256_state, m, blocks);
+			return;
 		case D_WHIRLPOOL:
-			state.whirlpool_state = whirlpool_round(state.whirlpool_state, m);
-			return state;
+			whirlpool_rounds(&state->whirlpool_state, m, blocks);
+			return;
+		case D_SHA384:
+		case D_SHA512:
+		case D_SHA512_256:
+			sha512_rounds(&state->sha512_state, m, blocks);
+			return;
+		case D_BLAKE3:
+			blake3_rounds(&state->blake3_state, m, blocks);
+			return;
 	}
 }
 
-static t_digest_hash digest_final_round(enum e_digest digest, t_digest_state state, const uint8_t m[DIGEST_BLOCK_BYTES], uint16_t bits) {
+/// `m` holds the last `bits` bits of the message, at most one block of `digest`
+static t_digest_hash digest_final_round(enum e_digest digest, t_digest_state state, const uint8_t *m, uint16_t bits) {
 	t_digest_hash hash;
 	switch (digest) {
 		case D_MD5:
@@ -157,9 +418,46 @@ static t_digest_hash digest_final_round(enum e_digest digest, t_digest_state sta
 		case D_WHIRLPOOL:
 			hash.whirlpool = whirlpool_final_round(state.whirlpool_state, m, bits);
 			return hash;
+		case D_SHA384:
+			hash.sha384 = sha384_final_round(state.sha512_state, m, bits);
+			return hash;
+		case D_SHA512:
+			hash.sha512 = sha512_final_round(state.sha512_state, m, bits);
+			return hash;
+		case D_SHA512_256:
+			hash.sha512_256 = sha512_256_final_round(state.sha512_state, m, bits);
+			return hash;
+		case D_BLAKE3:
+			hash.blake3 = blake3_final_round(state.blake3_state, m, bits);
+			return hash;
+	}
+}
+
+static size_t digest_hash_bytes(enum e_digest digest) {
+	switch (digest) {
+		case D_MD5:
+			return 16;
+		case D_SHA256:
+		case D_SHA512_256:
+		case D_BLAKE3:
+			return 32;
+		case D_SHA384:
+			return 48;
+		case D_WHIRLPOOL:
+		case D_SHA512:
+			return 64;
 	}
 }
 
+/// Hashes `size` bytes that are all in memory
+static t_digest_hash digest_bytes(enum e_digest digest, uint8_t const *data, size_t size) {
+	t_digest_state state = digest_state(digest);
+	size_t block_bytes = digest_block_bytes(digest);
+	size_t blocks = size / block_bytes;
+	digest_rounds(digest, &state, data, blocks);
+	return digest_final_round(digest, state, data + blocks * block_bytes, (size % block_bytes) * 8);
+}
+
 static void print_hash(int fd, enum e_digest digest, t_digest_hash *hash) {
 	switch (digest) {
 		case D_MD5: {
@@ -177,6 +475,26 @@ static void print_hash(int fd, enum e_digest digest, t_digest_hash *hash) {
 			ft_putstr(fd, hex.hex);
 			return;
 		}
+		case D_SHA384: {
+			struct hash384_hex hex = hash384_hex(&hash->sha384);
+			ft_putstr(fd, hex.hex);
+			return;
+		}
+		case D_SHA512: {
+			struct hash512_hex hex = hash512_hex(&hash->sha512);
+			ft_putstr(fd, hex.hex);
+			return;
+		}
+		case D_SHA512_256: {
+			struct hash256_hex hex = hash256_hex(&hash->sha512_256);
+			ft_putstr(fd, hex.hex);
+			return;
+		}
+		case D_BLAKE3: {
+			struct hash256_hex hex = hash256_hex(&hash->blake3);
+			ft_putstr(fd, hex.hex);
+			return;
+		}
 	}
 }
 
@@ -185,153 +503,1646 @@ static char const *digest_name(enum e_digest digest) {
 		[D_MD5] = "MD5",
 		[D_SHA256] = "SHA256",
 		[D_WHIRLPOOL] = "WHIRLPOOL",
+		[D_SHA384] = "SHA384",
+		[D_SHA512] = "SHA512",
+		[D_SHA512_256] = "SHA512-256",
+		[D_BLAKE3] = "BLAKE3",
 	};
 
 	return names[digest];
 }
 
-static void print_digest_buf(enum e_digest digest, uint8_t *buf, size_t size, struct digest_args *const opts) {
-	t_digest_state state = digest_state(digest);
-
-	if (!opts->quiet && !opts->reverse) {
-		ft_putstrs(STDOUT_FILENO, (char const*[]){digest_name(digest), "(\"", NULL});
-		print_escaped(STDOUT_FILENO, buf, size);
-		ft_putstr(STDOUT_FILENO, "\")= ");
+/// Hashes everything that can be read from `stream`
+/// When `echo` is set, everything that is read is also printed (escaped) to stdout
+/// Returns 0 on success, or the errno value of the failure
+static int digest_stream(enum e_digest digest, t_digest_state state, struct digest_file_stream *stream, bool echo, t_digest_hash *hash) {
+	if (stream->buffer == NULL && stream->pipeline == NULL) {
+		return ENOMEM;
 	}
+	size_t block_bytes = digest_block_bytes(digest);
 
-	size_t buf_index = 0;
-	while (size - buf_index > DIGEST_BLOCK_BYTES) {
-		state = digest_round(digest, state, buf + buf_index);
-	}
-	t_digest_hash hash = digest_final_round(digest, state, buf + buf_index, (size - buf_index) * 8);
-	print_hash(STDOUT_FILENO, digest, &hash);
+	while (true) {
+		ssize_t nread = read_file_blocks(stream);
+		if (nread < 0) {
+			return errno;
+		}
 
-	if (!opts->quiet && opts->reverse) {
-		ft_putstr(STDOUT_FILENO, " \"");
-		print_escaped(STDOUT_FILENO, buf, size);
-		ft_putstr(STDOUT_FILENO, "\"");
+		if (echo) {
+			print_escaped(STDOUT_FILENO, stream->buffer, nread);
+		}
+
+		size_t blocks = nread / block_bytes;
+		digest_rounds(digest, &state, stream->buffer, blocks);
+		if ((size_t)nread < stream->buffer_size) {
+			*hash = digest_final_round(digest, state, stream->buffer + blocks * block_bytes, (nread % block_bytes) * 8);
+			return 0;
+		}
 	}
-	ft_putstr(STDOUT_FILENO, "\n");
 }
 
-static t_result print_digest_file(enum e_digest digest, int fd, char *filename, struct digest_args *const opts) {
-	t_digest_state state = digest_state(digest);
-	struct digest_file_stream stream = file_stream(fd);
+/// `-tree CHUNK` hashes the input as a Merkle tree, with H the chosen digest:
+/// - the input is split into leaves of CHUNK bytes, the last one may be shorter, an empty input is one empty leaf
+/// - a leaf is H(0x00 || data), a node H(0x01 || left || right)
+/// - each level pairs its nodes from the left, an odd last node is promoted to the next level unchanged
+/// - the root is the only node of the last level, with a single leaf that's the leaf itself
+/// Threads only change when the leaves are hashed, never how they are combined
 
-	if (!opts->quiet && !opts->reverse) {
-		ft_putstrs(STDOUT_FILENO, (char const*[]){digest_name(digest), "(", filename, ")= ", NULL});
+struct tree_source {
+	int fd;
+	bool seekable; // read with pread(), so the leaves can be hashed in any order
+	uint8_t const *mem; // read instead of `fd` when set
+	size_t mem_size;
+};
+
+static ssize_t tree_source_read(struct tree_source const *source, uint8_t *buffer, size_t len, off_t offset) {
+	if (source->mem != NULL) {
+		size_t left = (size_t)offset < source->mem_size ? source->mem_size - offset : 0;
+		len = len < left ? len : left;
+		ft_memcpy(buffer, source->mem + offset, len);
+		return len;
+	}
+	if (source->seekable) {
+		return ft_pread_full(source->fd, buffer, len, offset);
+	}
+	return ft_read_full(source->fd, buffer, len);
+}
+
+/// Hashes the leaf of at most `len` bytes at `offset`, `leaf_len` is set to the amount of bytes it had
+/// Returns 0 on success, or the errno value of the failure
+static int digest_tree_leaf(enum e_digest digest, struct tree_source const *source, off_t offset, size_t len, t_digest_hash *hash, size_t *leaf_len) {
+	uint8_t *buffer = stream_buffer();
+	if (buffer == NULL) {
+		return ENOMEM;
 	}
+	t_digest_state state = digest_state(digest);
+	size_t block_bytes = digest_block_bytes(digest);
 
+	// The data is read right after the prefix, so the blocks stay aligned to the buffer
+	buffer[0] = 0x00;
+	size_t used = 1;
+	*leaf_len = 0;
 	while (true) {
-		ssize_t nread = read_file_block(&stream);
+		size_t want = len - *leaf_len;
+		if (want > DIGEST_STREAM_BYTES - used) {
+			want = DIGEST_STREAM_BYTES - used;
+		}
+		ssize_t nread = tree_source_read(source, buffer + used, want, offset + *leaf_len);
 		if (nread < 0) {
-			return set_error(E_ERRNO, "");
+			return errno;
 		}
+		used += nread;
+		*leaf_len += nread;
 
-		if (nread == DIGEST_BLOCK_BYTES) {
-			state = digest_round(digest, state, stream.buffer);
+		size_t blocks = used / block_bytes;
+		digest_rounds(digest, &state, buffer, blocks);
+		if ((size_t)nread < want || *leaf_len == len) {
+			*hash = digest_final_round(digest, state, buffer + blocks * block_bytes, (used % block_bytes) * 8);
+			return 0;
 		}
-		else {
-			t_digest_hash hash = digest_final_round(digest, state, stream.buffer, nread * 8);
-			print_hash(STDOUT_FILENO, digest, &hash);
+		used %= block_bytes;
+		memmove(buffer, buffer + blocks * block_bytes, used);
+	}
+}
+
+/// Reduces the `n` leaves in `nodes` level by level, overwriting them, and returns the root
+static t_digest_hash digest_tree_root(enum e_digest digest, t_digest_hash *nodes, uint64_t n) {
+	size_t hash_bytes = digest_hash_bytes(digest);
+	uint8_t pair[1 + 2 * sizeof(t_digest_hash)];
+	pair[0] = 0x01;
+
+	while (n > 1) {
+		for (uint64_t i = 0; i < n / 2; i++) {
+			ft_memcpy(pair + 1, &nodes[2 * i], hash_bytes);
+			ft_memcpy(pair + 1 + hash_bytes, &nodes[2 * i + 1], hash_bytes);
+			nodes[i] = digest_bytes(digest, pair, 1 + 2 * hash_bytes);
+		}
+		if (n % 2 == 1) {
+			nodes[n / 2] = nodes[n - 1];
+		}
+		n = (n + 1) / 2;
+	}
+	return nodes[0];
+}
+
+/// Hashes the leaves one after the other, for input that can only be read in order
+static int digest_tree_stream(enum e_digest digest, struct tree_source const *source, size_t chunk, t_digest_hash *hash, uint64_t *leaves) {
+	t_digest_hash *nodes = NULL;
+	uint64_t capacity = 0;
+	uint64_t n = 0;
+	int err = 0;
+
+	while (true) {
+		if (n == capacity) {
+			capacity = capacity == 0 ? 64 : capacity * 2;
+			t_digest_hash *grown = realloc(nodes, capacity * sizeof(*nodes));
+			if (grown == NULL) {
+				err = ENOMEM;
+				break;
+			}
+			nodes = grown;
+		}
+		size_t leaf_len;
+		err = digest_tree_leaf(digest, source, n * chunk, chunk, &nodes[n], &leaf_len);
+		// Only an empty input has an empty leaf
+		if (err != 0 || (leaf_len == 0 && n > 0)) {
+			break;
+		}
+		n++;
+		if (leaf_len < chunk) {
 			break;
 		}
 	}
 
-	if (!opts->quiet && opts->reverse) {
-		ft_putstrs(STDOUT_FILENO, (char const*[]){" ", filename, NULL});
+	if (err == 0) {
+		*hash = digest_tree_root(digest, nodes, n);
+		*leaves = n;
 	}
-	ft_putstr(STDOUT_FILENO, "\n");
-	return OK;
+	free(nodes);
+	return err;
 }
 
-static t_result print_digest_stdin(enum e_digest digest, struct digest_args *const opts) {
-	if (!opts->print) {
-		return print_digest_file(digest, STDIN_FILENO, "<stdin>", opts);
+static uint64_t tree_leaf_count(size_t size, size_t chunk) {
+	return size == 0 ? 1 : (size - 1) / chunk + 1;
+}
+
+struct tree_leaves_task {
+	enum e_digest digest;
+	struct tree_source const *source;
+	off_t start; // of the input in the file
+	size_t size;
+	size_t chunk;
+	uint64_t first;
+	uint64_t count;
+	t_digest_hash *nodes; // of all leaves
+	int err;
+};
+
+static void run_tree_leaves(void *arg) {
+	struct tree_leaves_task *task = arg;
+
+	for (uint64_t i = task->first; i < task->first + task->count; i++) {
+		size_t offset = i * task->chunk;
+		size_t len = task->size - offset < task->chunk ? task->size - offset : task->chunk;
+		size_t leaf_len;
+		task->err = digest_tree_leaf(task->digest, task->source, task->start + offset, len, &task->nodes[i], &leaf_len);
+		if (task->err == 0 && leaf_len != len) {
+			task->err = EIO; // the file shrank
+		}
+		if (task->err != 0) {
+			return;
+		}
 	}
+}
 
-	t_digest_state state = digest_state(digest);
-	struct digest_file_stream stream = file_stream(STDIN_FILENO);
+/// Hashes the leaves of `size` bytes of a regular file from `start` on `threads` threads, with pread()
+static int digest_tree_file(enum e_digest digest, struct tree_source const *source, off_t start, size_t size, size_t chunk, size_t threads, t_digest_hash *hash, uint64_t *leaves) {
+	uint64_t n = tree_leaf_count(size, chunk);
+	// A few runs of consecutive leaves per thread, so the reads stay sequential but uneven runs still balance
+	uint64_t task_num = threads > 1 && n > threads * 4 ? threads * 4 : threads > 1 ? n : 1;
+	t_digest_hash *nodes = malloc(n * sizeof(*nodes));
+	struct tree_leaves_task *tasks = malloc(task_num * sizeof(*tasks));
+	struct pool *pool = NULL;
+	int err = 0;
 
-	if (!opts->quiet) {
-		ft_putstrs(STDOUT_FILENO, (char const*[]){digest_name(digest), "(", NULL});
+	if (nodes == NULL || tasks == NULL) {
+		err = ENOMEM;
+		goto cleanup;
+	}
+	uint64_t first = 0;
+	for (uint64_t i = 0; i < task_num; i++) {
+		uint64_t count = n / task_num + (i < n % task_num);
+		tasks[i] = (struct tree_leaves_task){
+			.digest = digest,
+			.source = source,
+			.start = start,
+			.size = size,
+			.chunk = chunk,
+			.first = first,
+			.count = count,
+			.nodes = nodes,
+			.err = 0,
+		};
+		first += count;
 	}
-	ft_putstr(STDOUT_FILENO, "\"");
 
-	while (true) {
-		ssize_t nread = read_file_block(&stream);
-		if (nread < 0) {
-			return set_error(E_ERRNO, "");
+	if (task_num > 1 && pool_start(&pool, threads < task_num ? threads : task_num) != OK) {
+		pool = NULL;
+	}
+	for (uint64_t i = 0; i < task_num; i++) {
+		if (pool == NULL || pool_submit(pool, &run_tree_leaves, &tasks[i]) != OK) {
+			run_tree_leaves(&tasks[i]);
 		}
+	}
+	if (pool != NULL) {
+		pool_finish(pool);
+	}
+	reset_error();
+
+	for (uint64_t i = 0; i < task_num && err == 0; i++) {
+		err = tasks[i].err;
+	}
+	if (err == 0) {
+		*hash = digest_tree_root(digest, nodes, n);
+		*leaves = n;
+	}
 
-		print_escaped(STDOUT_FILENO, stream.buffer, nread);
+cleanup:
+	free(tasks);
+	free(nodes);
+	return err;
+}
 
-		if (nread == DIGEST_BLOCK_BYTES) {
-			state = digest_round(digest, state, stream.buffer);
-		}
-		else {
-			ft_putstr(STDOUT_FILENO, "\"");
-			if (!opts->quiet) {
-				ft_putstr(STDOUT_FILENO, ")= ");
-			}
-			else {
-				ft_putstr(STDOUT_FILENO, "\n");
-			}
-			t_digest_hash hash = digest_final_round(digest, state, stream.buffer, nread * 8);
-			print_hash(STDOUT_FILENO, digest, &hash);
-			break;
-		}
+/// Hashes the rest of the file behind `fd` as a tree of `chunk` byte leaves
+/// The leaves of a regular file are hashed on `threads` threads, other files are read in order
+/// Returns 0 on success, or the errno value of the failure
+static int digest_fd_tree(enum e_digest digest, int fd, size_t chunk, size_t threads, t_digest_hash *hash, uint64_t *leaves) {
+	struct stat st;
+	off_t start = lseek(fd, 0, SEEK_CUR);
+	struct tree_source source = {
+		.fd = fd,
+		.seekable = start >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode),
+		.mem = NULL,
+	};
+
+	if (!source.seekable) {
+		return digest_tree_stream(digest, &source, chunk, hash, leaves);
+	}
+	size_t size = st.st_size > start ? st.st_size - start : 0;
+	return digest_tree_file(digest, &source, start, size, chunk, threads, hash, leaves);
+}
+
+/// Name of the digest as printed, tree hashes get their own
+static char const *print_name_suffix(struct digest_args *const opts) {
+	return opts->tree_chunk != 0 ? "-TREE" : "";
+}
+
+/// With `-leaves`, the amount of leaves is printed at the end of the line
+static void print_line_end(uint64_t leaves, struct digest_args *const opts) {
+	if (opts->leaves) {
+		char buffer[21];
+		ft_putstrs(STDOUT_FILENO, (char const*[]){" (", ft_utoa(leaves, buffer), leaves == 1 ? " leaf)" : " leaves)", NULL});
 	}
 	ft_putstr(STDOUT_FILENO, "\n");
-	return OK;
 }
 
-static t_result exec_digest(enum e_digest digest, struct digest_args *const opts) {
-	if ((opts->file_num == 0 && !opts->string) || opts->print) {
-		set_err_object("<stdin>");
-		if (print_digest_stdin(digest, opts) != OK) {
-			return propagate_error();
+static t_result print_digest_buf(enum e_digest digest, uint8_t *buf, size_t size, struct digest_args *const opts) {
+	t_digest_hash hash;
+	uint64_t leaves = 0;
+	if (opts->tree_chunk != 0) {
+		struct tree_source source = { .fd = -1, .seekable = false, .mem = buf, .mem_size = size };
+		int err = digest_tree_stream(digest, &source, opts->tree_chunk, &hash, &leaves);
+		if (err != 0) {
+			errno = err;
+			return set_error(E_ERRNO, "");
 		}
-		reset_err_object();
 	}
-
-	if (opts->string != NULL) {
-		print_digest_buf(digest, (uint8_t*)opts->string, ft_strlen(opts->string), opts);
+	else {
+		hash = digest_bytes(digest, buf, size);
 	}
 
-	for (size_t i = 0; i < opts->file_num; i++) {
-		set_err_object(opts->files[i]);
-		int fd = open(opts->files[i], O_RDONLY);
-		if (fd < 0) {
-			print_error_local(STDERR_FILENO, NULL, E_ERRNO, NULL, NULL);
-			continue;
-		}
-		if (print_digest_file(digest, fd, opts->files[i], opts) != OK) {
-			close(fd);
-			return propagate_error();
-		}
-		close(fd);
+	if (!opts->quiet && !opts->reverse) {
+		ft_putstrs(STDOUT_FILENO, (char const*[]){digest_name(digest), print_name_suffix(opts), "(\"", NULL});
+		print_escaped(STDOUT_FILENO, buf, size);
+		ft_putstr(STDOUT_FILENO, "\")= ");
 	}
-	reset_err_object();
+	print_hash(STDOUT_FILENO, digest, &hash);
+	if (!opts->quiet && opts->reverse) {
+		ft_putstr(STDOUT_FILENO, " \"");
+		print_escaped(STDOUT_FILENO, buf, size);
+		ft_putstr(STDOUT_FILENO, "\"");
+	}
+	print_line_end(leaves, opts);
 	return OK;
 }
 
-t_result md5_digest(char **args) {
-	set_err_prefix("md5");
-	struct digest_args opts;
-	if (
-		parse_digest_args(args, &opts) != OK ||
-		exec_digest(D_MD5, &opts) != OK
-	) {
-		print_error(STDERR_FILENO);
-		exit(1);
+static _Thread_local sigjmp_buf *mapped_bus_jmp = NULL;
+
+static void mapped_bus_handler(int sig) {
+	if (mapped_bus_jmp != NULL) {
+		siglongjmp(*mapped_bus_jmp, 1);
 	}
-	reset_err_prefix();
-	return reset_error();
+	// The results printed so far are still written, like they were before output was buffered
+	output_flush_signal();
+	signal(sig, SIG_DFL);
+	raise(sig);
 }
 
-t_result sha256_digest(char **args) {
-	set_err_prefix("sha256");
+static pthread_once_t mapped_bus_once = PTHREAD_ONCE_INIT;
+static bool mapped_bus_installed = false;
+
+static void install_mapped_bus_handler(void) {
+	struct sigaction action = {
+		.sa_handler = &mapped_bus_handler,
+	};
+	sigemptyset(&action.sa_mask);
+	mapped_bus_installed = sigaction(SIGBUS, &action, NULL) == 0;
+}
+
+struct blake3_subtree_task {
+	uint8_t const *data;
+	size_t len;
+	uint64_t chunk_counter;
+	uint32_t cv[8];
+	bool failed; // the mapping went away underneath
+};
+
+static void run_blake3_subtree(void *arg) {
+	struct blake3_subtree_task *task = arg;
+
+	sigjmp_buf bus_jmp;
+	if (sigsetjmp(bus_jmp, 1) != 0) {
+		mapped_bus_jmp = NULL;
+		task->failed = true;
+		return;
+	}
+	mapped_bus_jmp = &bus_jmp;
+	blake3_subtree(task->data, task->len, task->chunk_counter, task->cv);
+	mapped_bus_jmp = NULL;
+}
+
+/// Hashes mapped BLAKE3 input as independent subtrees on `threads` threads, then merges their chaining values
+/// Returns false when it could not, the input should then be hashed sequentially
+static bool digest_blake3_tree(uint8_t const *data, size_t size, size_t threads, struct hash256 *hash) {
+	size_t subtree_bytes = blake3_subtree_bytes(size, threads * 4);
+	if (subtree_bytes == 0) {
+		return false;
+	}
+	size_t task_num = (size + subtree_bytes - 1) / subtree_bytes;
+	struct blake3_subtree_task *tasks = malloc(task_num * sizeof(*tasks));
+	uint32_t (*cvs)[8] = malloc(task_num * sizeof(*cvs));
+	struct pool *pool = NULL;
+	bool done = false;
+
+	if (tasks == NULL || cvs == NULL || pool_start(&pool, threads < task_num ? threads : task_num) != OK) {
+		goto cleanup;
+	}
+	size_t submitted = 0;
+	for (; submitted < task_num; submitted++) {
+		size_t offset = submitted * subtree_bytes;
+		tasks[submitted] = (struct blake3_subtree_task){
+			.data = data + offset,
+			.len = size - offset < subtree_bytes ? size - offset : subtree_bytes,
+			.chunk_counter = offset / BLAKE3_CHUNK_BYTES,
+			.failed = false,
+		};
+		if (pool_submit(pool, &run_blake3_subtree, &tasks[submitted]) != OK) {
+			break;
+		}
+	}
+	pool_finish(pool);
+
+	done = submitted == task_num;
+	for (size_t i = 0; i < submitted; i++) {
+		done = done && !tasks[i].failed;
+		ft_memcpy(cvs[i], tasks[i].cv, sizeof(*cvs));
+	}
+	if (done) {
+		*hash = blake3_merge_subtrees((uint32_t const (*)[8])cvs, task_num);
+	}
+
+cleanup:
+	reset_error();
+	free(cvs);
+	free(tasks);
+	return done;
+}
+
+/// Hashes the rest of a regular file straight from a mapping of it
+/// Large files are split over `threads` threads when the digest is a tree
+/// Returns false when (part of) the file could not be hashed this way,
+/// `state` and `offset` then describe the progress so the rest can be read normally
+static bool digest_mapped(enum e_digest digest, int fd, size_t threads, t_digest_state *state, off_t *offset, t_digest_hash *hash) {
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+		return false;
+	}
+	pthread_once(&mapped_bus_once, &install_mapped_bus_handler);
+	off_t start = lseek(fd, 0, SEEK_CUR);
+	if (start < 0 || start >= st.st_size || !mapped_bus_installed) {
+		return false;
+	}
+
+	long page_size = sysconf(_SC_PAGESIZE);
+	off_t map_start = start - start % page_size;
+	size_t map_size = st.st_size - map_start;
+	uint8_t *map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, map_start);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+	madvise(map, map_size, MADV_SEQUENTIAL);
+
+	uint8_t const *data = map + (start - map_start);
+	size_t size = st.st_size - start;
+
+	// A file that shrinks underneath is hashed again sequentially, which then falls back to read()
+	if (digest == D_BLAKE3 && threads > 1 && size >= DIGEST_TREE_MIN_BYTES && digest_blake3_tree(data, size, threads, &hash->blake3)) {
+		munmap(map, map_size);
+		*offset = st.st_size;
+		return true;
+	}
+
+	// Everything before `done` is included in `checkpoint`, if the file shrinks
+	// underneath the mapping (SIGBUS) hashing resumes from there using read()
+	sigjmp_buf bus_jmp;
+	t_digest_state volatile checkpoint = *state;
+	size_t volatile done = 0;
+	if (sigsetjmp(bus_jmp, 1) != 0) {
+		mapped_bus_jmp = NULL;
+		munmap(map, map_size);
+		*state = checkpoint;
+		*offset = start + done;
+		return false;
+	}
+	mapped_bus_jmp = &bus_jmp;
+
+	size_t block_bytes = digest_block_bytes(digest);
+	size_t blocks_size = size - size % block_bytes;
+	while (done < blocks_size) {
+		size_t window = blocks_size - done;
+		if (window > DIGEST_MMAP_WINDOW) {
+			window = DIGEST_MMAP_WINDOW;
+			uintptr_t ahead = (uintptr_t)(data + done + window);
+			ahead -= ahead % page_size;
+			size_t ahead_size = (uintptr_t)(map + map_size) - ahead;
+			madvise((void *)ahead, ahead_size < DIGEST_MMAP_WINDOW ? ahead_size : DIGEST_MMAP_WINDOW, MADV_WILLNEED);
+		}
+		digest_rounds(digest, state, data + done, window / block_bytes);
+		checkpoint = *state;
+		done += window;
+	}
+	*hash = digest_final_round(digest, *state, data + done, (size - done) * 8);
+
+	mapped_bus_jmp = NULL;
+	munmap(map, map_size);
+	*offset = st.st_size;
+	return true;
+}
+
+/// Hashes the rest of the file behind `fd`, this is safe to call from any thread
+/// `threads` is the amount of threads a single large file may be hashed on
+/// Returns 0 on success, or the errno value of the failure
+static int digest_fd(enum e_digest digest, int fd, size_t threads, t_digest_hash *hash) {
+	t_digest_state state = digest_state(digest);
+	off_t offset = 0;
+
+	if (digest_mapped(digest, fd, threads, &state, &offset, hash)) {
+		return 0;
+	}
+	if (offset != 0 && lseek(fd, offset, SEEK_SET) < 0) {
+		return errno;
+	}
+	struct digest_file_stream stream = file_stream(fd);
+	int err = digest_stream(digest, state, &stream, false, hash);
+	file_stream_finish(&stream);
+	return err;
+}
+
+/// `leaves` is only used for tree hashes
+static void print_digest_line(enum e_digest digest, char const *filename, t_digest_hash *hash, uint64_t leaves, struct digest_args *const opts) {
+	if (!opts->quiet && !opts->reverse) {
+		ft_putstrs(STDOUT_FILENO, (char const*[]){digest_name(digest), print_name_suffix(opts), "(", filename, ")= ", NULL});
+	}
+	print_hash(STDOUT_FILENO, digest, hash);
+	if (!opts->quiet && opts->reverse) {
+		ft_putstrs(STDOUT_FILENO, (char const*[]){" ", filename, NULL});
+	}
+	print_line_end(leaves, opts);
+}
+
+/// Files modified this recently may still change without their modification time changing
+#ifndef DIGEST_CACHE_SETTLE_SECONDS
+# define DIGEST_CACHE_SETTLE_SECONDS 2
+#endif
+
+/// Hashes the rest of the file behind `fd` like `digest_fd`, or `digest_fd_tree` when `tree_chunk` is set
+/// With a cache, whole regular files are looked up first, and stored when they didn't change while being hashed
+/// Returns 0 on success, or the errno value of the failure
+static int digest_fd_cached(enum e_digest digest, int fd, size_t tree_chunk, size_t threads, struct digest_cache *cache, t_digest_hash *hash, uint64_t *leaves) {
+	size_t hash_bytes = digest_hash_bytes(digest);
+	struct stat before;
+	struct cache_key key;
+	bool cacheable = cache != NULL && fstat(fd, &before) == 0 && S_ISREG(before.st_mode) && lseek(fd, 0, SEEK_CUR) == 0;
+	if (cacheable) {
+		key = cache_key(&before, digest, tree_chunk);
+		if (cache_lookup(cache, &key, (uint8_t *)hash, hash_bytes)) {
+			*leaves = tree_chunk != 0 ? tree_leaf_count(before.st_size, tree_chunk) : 0;
+			return 0;
+		}
+	}
+
+	int err = tree_chunk != 0
+		? digest_fd_tree(digest, fd, tree_chunk, threads, hash, leaves)
+		: digest_fd(digest, fd, threads, hash);
+
+	struct stat after;
+	struct timespec now;
+	if (
+		err == 0 && cacheable &&
+		fstat(fd, &after) == 0 &&
+		after.st_size == before.st_size &&
+		after.st_mtim.tv_sec == before.st_mtim.tv_sec &&
+		after.st_mtim.tv_nsec == before.st_mtim.tv_nsec &&
+		clock_gettime(CLOCK_REALTIME, &now) == 0 &&
+		now.tv_sec - after.st_mtim.tv_sec >= DIGEST_CACHE_SETTLE_SECONDS
+	) {
+		cache_store(cache, &key, (uint8_t const *)hash, hash_bytes);
+	}
+	return err;
+}
+
+static t_result print_digest_file(enum e_digest digest, int fd, char *filename, struct digest_args *const opts) {
+	t_digest_hash hash;
+	uint64_t leaves = 0;
+	size_t threads = opts->jobs > 1 ? opts->jobs : pool_default_threads();
+	int err = digest_fd_cached(digest, fd, opts->tree_chunk, threads, opts->cache, &hash, &leaves);
+	if (err != 0) {
+		errno = err;
+		return set_error(E_ERRNO, "");
+	}
+	print_digest_line(digest, filename, &hash, leaves, opts);
+	return OK;
+}
+
+static t_result print_digest_stdin(enum e_digest digest, struct digest_args *const opts) {
+	if (!opts->print) {
+		return print_digest_file(digest, STDIN_FILENO, "<stdin>", opts);
+	}
+
+	struct digest_file_stream stream = file_stream(STDIN_FILENO);
+
+	if (!opts->quiet) {
+		ft_putstrs(STDOUT_FILENO, (char const*[]){digest_name(digest), "(", NULL});
+	}
+	ft_putstr(STDOUT_FILENO, "\"");
+
+	t_digest_hash hash;
+	int err = digest_stream(digest, digest_state(digest), &stream, true, &hash);
+	file_stream_finish(&stream);
+	if (err != 0) {
+		errno = err;
+		return set_error(E_ERRNO, "");
+	}
+
+	ft_putstr(STDOUT_FILENO, "\"");
+	if (!opts->quiet) {
+		ft_putstr(STDOUT_FILENO, ")= ");
+	}
+	else {
+		ft_putstr(STDOUT_FILENO, "\n");
+	}
+	print_hash(STDOUT_FILENO, digest, &hash);
+	ft_putstr(STDOUT_FILENO, "\n");
+	return OK;
+}
+
+struct digest_job {
+	struct digest_batch *batch;
+	char const *filename;
+	off_t size;
+	bool multibuffer; // hashed on the reporting thread, together with the other small files
+	bool done;
+	bool open_failed;
+	int err;
+	t_digest_hash hash;
+	uint64_t leaves;
+};
+
+/// Called for every finished job, in the order they are reported in
+typedef t_result (t_digest_report)(struct digest_job *job, void *ctx);
+
+struct digest_batch {
+	enum e_digest digest;
+	size_t tree_chunk;
+	struct digest_cache *cache;
+	pthread_mutex_t lock;
+	pthread_cond_t job_done;
+	bool cancelled;
+	struct digest_job *jobs;
+	size_t job_num;
+	size_t *finished; // job indices in the order they finished
+	size_t finished_num;
+};
+
+static void finish_digest_job(struct digest_job *job) {
+	struct digest_batch *batch = job->batch;
+
+	pthread_mutex_lock(&batch->lock);
+	job->done = true;
+	batch->finished[batch->finished_num++] = job - batch->jobs;
+	pthread_cond_broadcast(&batch->job_done);
+	pthread_mutex_unlock(&batch->lock);
+}
+
+static void run_digest_job(void *arg) {
+	struct digest_job *job = arg;
+	struct digest_batch *batch = job->batch;
+
+	pthread_mutex_lock(&batch->lock);
+	bool cancelled = batch->cancelled;
+	pthread_mutex_unlock(&batch->lock);
+
+	if (!cancelled) {
+		int fd = open(job->filename, O_RDONLY);
+		if (fd < 0) {
+			job->open_failed = true;
+			job->err = errno;
+		}
+		else {
+			job->err = digest_fd_cached(batch->digest, fd, batch->tree_chunk, 1, batch->cache, &job->hash, &job->leaves);
+			close(fd);
+		}
+	}
+	finish_digest_job(job);
+}
+
+static struct mb_algorithm const *digest_mb(enum e_digest digest) {
+	switch (digest) {
+		case D_MD5:
+			return md5_mb();
+		case D_SHA256:
+			return sha256_mb();
+		case D_WHIRLPOOL:
+		case D_SHA384:
+		case D_SHA512:
+		case D_SHA512_256:
+		case D_BLAKE3:
+			return NULL;
+	}
+}
+
+/// Reads a whole small file into `buffer`, which has room for one byte more than the file had when it was checked
+/// Returns -1 when the job was finished without it: it could not be read or grew and was hashed on its own
+static ssize_t read_small_file(struct digest_job *job, uint8_t *buffer) {
+	int fd = open(job->filename, O_RDONLY);
+	if (fd < 0) {
+		job->open_failed = true;
+		job->err = errno;
+		finish_digest_job(job);
+		return -1;
+	}
+	ssize_t len = ft_read_full(fd, buffer, job->size + 1);
+	int err = errno;
+	close(fd);
+
+	if (len < 0) {
+		job->err = err;
+		finish_digest_job(job);
+		return -1;
+	}
+	if (len > job->size) {
+		run_digest_job(job);
+		return -1;
+	}
+	return len;
+}
+
+/// Hashes the small files in batches, a lane of the kernel is refilled with the next file as soon as it is done
+static void digest_small_files(struct digest_batch *batch, struct mb_algorithm const *mb) {
+	uint8_t *buffer = malloc(DIGEST_MB_BATCH_BYTES);
+	struct mb_job *mb_jobs = malloc(batch->job_num * sizeof(*mb_jobs));
+	struct digest_job **jobs = malloc(batch->job_num * sizeof(*jobs));
+
+	if (buffer == NULL || mb_jobs == NULL || jobs == NULL) {
+		for (size_t i = 0; i < batch->job_num; i++) {
+			if (batch->jobs[i].multibuffer) {
+				run_digest_job(&batch->jobs[i]);
+			}
+		}
+	}
+	else {
+		size_t i = 0;
+		while (i < batch->job_num) {
+			size_t used = 0;
+			size_t count = 0;
+			for (; i < batch->job_num; i++) {
+				struct digest_job *job = &batch->jobs[i];
+				if (!job->multibuffer) {
+					continue;
+				}
+				if (used + job->size + 1 > DIGEST_MB_BATCH_BYTES) {
+					break;
+				}
+				ssize_t len = read_small_file(job, buffer + used);
+				if (len < 0) {
+					continue;
+				}
+				mb_jobs[count] = (struct mb_job){ .data = buffer + used, .len = len, .hash = &job->hash };
+				jobs[count++] = job;
+				used += len;
+			}
+
+			mb_hash_jobs(mb, mb_jobs, count);
+			for (size_t j = 0; j < count; j++) {
+				finish_digest_job(jobs[j]);
+			}
+		}
+	}
+	free(jobs);
+	free(mb_jobs);
+	free(buffer);
+}
+
+static int compare_job_size(void const *a, void const *b) {
+	struct digest_job const *job_a = *(struct digest_job *const *)a;
+	struct digest_job const *job_b = *(struct digest_job *const *)b;
+	return (job_a->size < job_b->size) - (job_a->size > job_b->size);
+}
+
+/// Files that can't be opened or read are reported and skipped, like in the sequential loop
+/// `opts` is the `struct digest_args`
+static t_result report_digest_job(struct digest_job *job, void *opts) {
+	set_err_object(job->filename);
+	if (job->err != 0) {
+		errno = job->err;
+		print_error_local(STDERR_FILENO, NULL, E_ERRNO, NULL, NULL);
+		if (!job->open_failed) {
+			((struct digest_args *)opts)->read_failed = true;
+		}
+		return OK;
+	}
+	print_digest_line(job->batch->digest, job->filename, &job->hash, job->leaves, opts);
+	return OK;
+}
+
+/// Waits for the jobs in argv order, or in the order they finish when `opts->unordered` is set
+static t_result report_digest_jobs(struct digest_batch *batch, struct digest_args *const opts, t_digest_report *report, void *ctx) {
+	for (size_t i = 0; i < batch->job_num; i++) {
+		pthread_mutex_lock(&batch->lock);
+		while (opts->unordered ? batch->finished_num <= i : !batch->jobs[i].done) {
+			pthread_cond_wait(&batch->job_done, &batch->lock);
+		}
+		struct digest_job *job = &batch->jobs[opts->unordered ? batch->finished[i] : i];
+		pthread_mutex_unlock(&batch->lock);
+
+		if (report(job, ctx) != OK) {
+			pthread_mutex_lock(&batch->lock);
+			batch->cancelled = true;
+			pthread_mutex_unlock(&batch->lock);
+			return propagate_error();
+		}
+	}
+	return OK;
+}
+
+/// Hashes the files on `threads` threads, the largest files are started first
+/// When the digest has a multi-buffer kernel, small regular files are hashed together on this thread instead
+/// Every job is passed to `report` with `ctx`, the batch stops at the first one that fails
+static t_result exec_digest_files_parallel(enum e_digest digest, char const *const *files, size_t file_num, size_t threads, struct digest_args *const opts, t_digest_report *report, void *ctx) {
+	// Cached files shouldn't be read at all, and trees have no multi-buffer kernel
+	struct mb_algorithm const *mb = opts->tree_chunk == 0 && opts->cache == NULL ? digest_mb(digest) : NULL;
+	struct digest_batch batch = {
+		.digest = digest,
+		.tree_chunk = opts->tree_chunk,
+		.cache = opts->cache,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.job_done = PTHREAD_COND_INITIALIZER,
+		.jobs = calloc(file_num, sizeof(*batch.jobs)),
+		.job_num = file_num,
+		.finished = malloc(file_num * sizeof(*batch.finished)),
+	};
+	struct digest_job **by_size = malloc(file_num * sizeof(*by_size));
+	size_t pool_job_num = 0;
+	struct pool *pool = NULL;
+	t_result result = OK;
+
+	if (batch.jobs == NULL || batch.finished == NULL || by_size == NULL) {
+		result = set_error(E_ERRNO, "");
+		goto cleanup;
+	}
+
+	for (size_t i = 0; i < file_num; i++) {
+		struct stat st;
+		bool found = stat(files[i], &st) == 0;
+		batch.jobs[i] = (struct digest_job){
+			.batch = &batch,
+			.filename = files[i],
+			.size = found ? st.st_size : 0,
+			.multibuffer = mb != NULL && found && S_ISREG(st.st_mode) && st.st_size <= DIGEST_MB_MAX_BYTES,
+		};
+		if (!batch.jobs[i].multibuffer) {
+			by_size[pool_job_num++] = &batch.jobs[i];
+		}
+	}
+	qsort(by_size, pool_job_num, sizeof(*by_size), &compare_job_size);
+
+	if (pool_job_num > 0 && pool_start(&pool, threads < pool_job_num ? threads : pool_job_num) != OK) {
+		result = propagate_error();
+		goto cleanup;
+	}
+	for (size_t i = 0; i < pool_job_num; i++) {
+		if (pool_submit(pool, &run_digest_job, by_size[i]) != OK) {
+			// Jobs that were never queued will never finish, so nothing can be reported
+			pthread_mutex_lock(&batch.lock);
+			batch.cancelled = true;
+			pthread_mutex_unlock(&batch.lock);
+			result = propagate_error();
+			goto cleanup;
+		}
+	}
+	if (mb != NULL) {
+		digest_small_files(&batch, mb);
+	}
+	result = report_digest_jobs(&batch, opts, report, ctx);
+
+cleanup:
+	if (pool != NULL) {
+		pool_finish(pool);
+	}
+	pthread_cond_destroy(&batch.job_done);
+	pthread_mutex_destroy(&batch.lock);
+	free(by_size);
+	free(batch.finished);
+	free(batch.jobs);
+	return result;
+}
+
+struct digest_uring_ctx {
+	struct digest_batch *batch;
+	struct digest_args *opts;
+	t_digest_state *states;
+	size_t next_report;
+};
+
+/// Reports the finished job, and in argv order every job that was waiting on it
+static bool report_uring_job(struct digest_uring_ctx *ctx, size_t file) {
+	struct digest_batch *batch = ctx->batch;
+	batch->jobs[file].done = true;
+	if (ctx->opts->unordered) {
+		return report_digest_job(&batch->jobs[file], ctx->opts) == OK;
+	}
+	while (ctx->next_report < batch->job_num && batch->jobs[ctx->next_report].done) {
+		if (report_digest_job(&batch->jobs[ctx->next_report], ctx->opts) != OK) {
+			return false;
+		}
+		ctx->next_report++;
+	}
+	return true;
+}
+
+static bool uring_digest_data(void *ctx_ptr, size_t file, uint8_t const *data, size_t len, bool eof) {
+	struct digest_uring_ctx *ctx = ctx_ptr;
+	enum e_digest digest = ctx->batch->digest;
+
+	size_t block_bytes = digest_block_bytes(digest);
+	size_t blocks = len / block_bytes;
+	digest_rounds(digest, &ctx->states[file], data, blocks);
+	if (!eof) {
+		return true;
+	}
+	ctx->batch->jobs[file].hash = digest_final_round(digest, ctx->states[file], data + blocks * block_bytes, (len % block_bytes) * 8);
+	return report_uring_job(ctx, file);
+}
+
+static bool uring_digest_error(void *ctx_ptr, size_t file, int err, bool opening) {
+	struct digest_uring_ctx *ctx = ctx_ptr;
+	ctx->batch->jobs[file].err = err;
+	ctx->batch->jobs[file].open_failed = opening;
+	return report_uring_job(ctx, file);
+}
+
+/// Reads many files at once through io_uring and hashes them on this thread as their data arrives
+static t_result exec_digest_files_uring(enum e_digest digest, struct digest_args *const opts, struct uring_reader *reader) {
+	struct digest_batch batch = {
+		.digest = digest,
+		.jobs = calloc(opts->file_num, sizeof(*batch.jobs)),
+		.job_num = opts->file_num,
+	};
+	struct digest_uring_ctx ctx = {
+		.batch = &batch,
+		.opts = opts,
+		.states = malloc(opts->file_num * sizeof(*ctx.states)),
+		.next_report = 0,
+	};
+	t_result result = OK;
+
+	if (batch.jobs == NULL || ctx.states == NULL) {
+		result = set_error(E_ERRNO, "");
+	}
+	else {
+		for (size_t i = 0; i < opts->file_num; i++) {
+			batch.jobs[i] = (struct digest_job){
+				.batch = &batch,
+				.filename = opts->files[i],
+			};
+			ctx.states[i] = digest_state(digest);
+		}
+		result = uring_read_files(reader, (char const *const *)opts->files, opts->file_num, &uring_digest_data, &uring_digest_error, &ctx);
+	}
+
+	free(ctx.states);
+	free(batch.jobs);
+	return result;
+}
+
+/// Reads a file line by line, lines can be of any length
+struct line_reader {
+	int fd;
+	uint8_t *buffer;
+	size_t start;
+	size_t end;
+	bool eof;
+	char *line;
+	size_t line_cap;
+	size_t line_num;
+};
+
+/// Sets `line` to the next line without its newline, it stays valid until the next call
+/// Returns 1 when there was a line, 0 at the end of the file, or -1 when reading failed
+static int read_line(struct line_reader *reader, char **line, size_t *line_len) {
+	size_t len = 0;
+	bool found = false;
+	while (!found) {
+		if (reader->start == reader->end) {
+			if (reader->eof) {
+				break;
+			}
+			ssize_t nread = read(reader->fd, reader->buffer, DIGEST_STREAM_BYTES);
+			if (nread < 0) {
+				return -1;
+			}
+			reader->start = 0;
+			reader->end = nread;
+			reader->eof = nread == 0;
+			continue;
+		}
+		uint8_t const *newline = memchr(reader->buffer + reader->start, '\n', reader->end - reader->start);
+		size_t take = (newline != NULL ? (size_t)(newline - reader->buffer) : reader->end) - reader->start;
+		if (len + take + 1 > reader->line_cap) {
+			size_t cap = reader->line_cap == 0 ? 256 : reader->line_cap;
+			while (len + take + 1 > cap) {
+				cap *= 2;
+			}
+			char *grown = realloc(reader->line, cap);
+			if (grown == NULL) {
+				return -1;
+			}
+			reader->line = grown;
+			reader->line_cap = cap;
+		}
+		ft_memcpy(reader->line + len, reader->buffer + reader->start, take);
+		len += take;
+		reader->start += take;
+		if (newline != NULL) {
+			reader->start++;
+			found = true;
+		}
+	}
+	// The last line may lack its newline
+	if (!found && len == 0) {
+		return 0;
+	}
+	reader->line[len] = '\0';
+	reader->line_num++;
+	*line = reader->line;
+	*line_len = len;
+	return 1;
+}
+
+static int hex_value(char c) {
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+static bool parse_hex(char const *hex, size_t bytes, uint8_t *out) {
+	for (size_t i = 0; i < bytes; i++) {
+		int high = hex_value(hex[2 * i]);
+		int low = hex_value(hex[2 * i + 1]);
+		if (high < 0 || low < 0) {
+			return false;
+		}
+		out[i] = high << 4 | low;
+	}
+	return true;
+}
+
+/// Files being hashed together, their names are NUL-separated in `names`
+struct file_batch {
+	char *names;
+	size_t names_len;
+	size_t names_cap;
+	size_t name_offsets[DIGEST_FILE_BATCH];
+	char const *files[DIGEST_FILE_BATCH];
+	size_t count;
+};
+
+/// Manifest lines whose files are being hashed
+struct check_batch {
+	struct file_batch files;
+	t_digest_hash expected[DIGEST_FILE_BATCH];
+};
+
+struct check_ctx {
+	struct digest_args *opts;
+	struct check_batch *batch;
+	size_t checked;
+	size_t failed;
+	size_t unreadable;
+	size_t malformed;
+};
+
+/// Parses a line in the output format of the digest (`ALG(file)= hex`) or the `-r` one (`hex file`)
+/// Returns false when it is neither
+static bool parse_check_line(enum e_digest digest, struct digest_args *const opts, char const *line, size_t len, char const **file, size_t *file_len, t_digest_hash *expected) {
+	size_t hex_len = 2 * digest_hash_bytes(digest);
+	char const *name = digest_name(digest);
+	char const *suffix = print_name_suffix(opts);
+	size_t name_len = ft_strlen(name);
+	size_t suffix_len = ft_strlen(suffix);
+
+	size_t prefix_len = name_len + suffix_len + 1;
+	if (
+		len > prefix_len + 3 + hex_len &&
+		memcmp(line, name, name_len) == 0 &&
+		memcmp(line + name_len, suffix, suffix_len) == 0 &&
+		line[prefix_len - 1] == '(' &&
+		memcmp(line + len - hex_len - 3, ")= ", 3) == 0 &&
+		parse_hex(line + len - hex_len, hex_len / 2, (uint8_t *)expected)
+	) {
+		*file = line + prefix_len;
+		*file_len = len - hex_len - 3 - prefix_len;
+		return true;
+	}
+	if (len > hex_len + 1 && line[hex_len] == ' ' && parse_hex(line, hex_len / 2, (uint8_t *)expected)) {
+		*file = line + hex_len + 1;
+		*file_len = len - hex_len - 1;
+		return true;
+	}
+	return false;
+}
+
+static bool file_batch_add(struct file_batch *batch, char const *file, size_t file_len) {
+	if (batch->names_len + file_len + 1 > batch->names_cap) {
+		size_t cap = batch->names_cap == 0 ? 64 * 1024 : batch->names_cap;
+		while (batch->names_len + file_len + 1 > cap) {
+			cap *= 2;
+		}
+		char *grown = realloc(batch->names, cap);
+		if (grown == NULL) {
+			return false;
+		}
+		batch->names = grown;
+		batch->names_cap = cap;
+	}
+	ft_memcpy(batch->names + batch->names_len, file, file_len);
+	batch->names[batch->names_len + file_len] = '\0';
+	batch->name_offsets[batch->count] = batch->names_len;
+	batch->names_len += file_len + 1;
+	batch->count++;
+	return true;
+}
+
+/// Hashes the files of the batch and empties it, every job is passed to `report` with `ctx`
+static t_result exec_file_batch(enum e_digest digest, struct file_batch *batch, struct digest_args *const opts, t_digest_report *report, void *ctx) {
+	for (size_t i = 0; i < batch->count; i++) {
+		batch->files[i] = batch->names + batch->name_offsets[i];
+	}
+	size_t threads = opts->jobs > 1 ? opts->jobs : pool_default_threads();
+	t_result result = exec_digest_files_parallel(digest, batch->files, batch->count, threads, opts, report, ctx);
+	batch->count = 0;
+	batch->names_len = 0;
+	return result;
+}
+
+static bool check_batch_add(struct check_batch *batch, char const *file, size_t file_len, t_digest_hash const *expected) {
+	batch->expected[batch->files.count] = *expected;
+	return file_batch_add(&batch->files, file, file_len);
+}
+
+/// Prints `file: OK` (unless quiet) or `file: FAILED`, unreadable files are reported on stderr
+static t_result report_check_job(struct digest_job *job, void *ctx_ptr) {
+	struct check_ctx *ctx = ctx_ptr;
+	size_t index = job - job->batch->jobs;
+
+	ctx->checked++;
+	if (job->err != 0) {
+		ctx->unreadable++;
+		errno = job->err;
+		print_error_local(STDERR_FILENO, NULL, E_ERRNO, job->filename, NULL);
+		ft_putstrs(STDOUT_FILENO, (char const*[]){job->filename, ": FAILED open or read\n", NULL});
+		return OK;
+	}
+	if (memcmp(&job->hash, &ctx->batch->expected[index], digest_hash_bytes(job->batch->digest)) != 0) {
+		ctx->failed++;
+		ft_putstrs(STDOUT_FILENO, (char const*[]){job->filename, ": FAILED\n", NULL});
+	}
+	else if (!ctx->opts->quiet) {
+		ft_putstrs(STDOUT_FILENO, (char const*[]){job->filename, ": OK\n", NULL});
+	}
+	return OK;
+}
+
+static void print_malformed_line(char const *manifest, size_t line_num) {
+	char buffer[21];
+	char const *parts[] = { "Line ", ft_utoa(line_num, buffer), " is improperly formatted", NULL };
+	char msg[64];
+	size_t len = 0;
+	for (size_t i = 0; parts[i] != NULL; i++) {
+		size_t part_len = ft_strlen(parts[i]);
+		ft_memcpy(msg + len, parts[i], part_len);
+		len += part_len;
+	}
+	msg[len] = '\0';
+	print_error_local(STDERR_FILENO, NULL, E_CHECK_FAILED, manifest, msg);
+}
+
+/// Prints how the check went, e.g. `10 files: 8 OK, 1 FAILED, 1 unreadable`
+static void print_check_summary(struct check_ctx const *ctx) {
+	char buffers[4][21];
+	ft_putstrs(STDOUT_FILENO, (char const*[]){
+		ft_utoa(ctx->checked, buffers[0]), ctx->checked == 1 ? " file: " : " files: ",
+		ft_utoa(ctx->checked - ctx->failed - ctx->unreadable, buffers[1]), " OK, ",
+		ft_utoa(ctx->failed, buffers[2]), " FAILED, ",
+		ft_utoa(ctx->unreadable, buffers[3]), " unreadable",
+		NULL,
+	});
+	if (ctx->malformed > 0) {
+		char buffer[21];
+		ft_putstrs(STDOUT_FILENO, (char const*[]){", ", ft_utoa(ctx->malformed, buffer), ctx->malformed == 1 ? " malformed line" : " malformed lines", NULL});
+	}
+	ft_putstr(STDOUT_FILENO, "\n");
+}
+
+/// Verifies the files of the manifest `opts->check`, which is read a batch of lines at a time
+/// Fails when a file doesn't match, can't be read, or a line can't be parsed
+static t_result exec_digest_check(enum e_digest digest, struct digest_args *const opts) {
+	bool from_stdin = ft_streq(opts->check, "-");
+	set_err_object(from_stdin ? "<stdin>" : opts->check);
+	int fd = from_stdin ? STDIN_FILENO : open(opts->check, O_RDONLY);
+	if (fd < 0) {
+		return set_error(E_ERRNO, "");
+	}
+
+	struct line_reader reader = { .fd = fd, .buffer = malloc(DIGEST_STREAM_BYTES) };
+	struct check_batch *batch = malloc(sizeof(*batch));
+	struct check_ctx ctx = { .opts = opts, .batch = batch };
+	t_result result = OK;
+
+	if (reader.buffer == NULL || batch == NULL) {
+		result = set_error(E_ERRNO, "");
+		goto cleanup;
+	}
+	*batch = (struct check_batch){ .files.names = NULL };
+
+	while (true) {
+		char *line;
+		size_t len;
+		int status = read_line(&reader, &line, &len);
+		if (status < 0) {
+			set_err_object(from_stdin ? "<stdin>" : opts->check);
+			result = set_error(E_ERRNO, "");
+			goto cleanup;
+		}
+		if (status == 0) {
+			break;
+		}
+		if (len > 0 && line[len - 1] == '\r') {
+			line[--len] = '\0';
+		}
+		if (len == 0) {
+			continue;
+		}
+
+		char const *file;
+		size_t file_len;
+		t_digest_hash expected;
+		if (!parse_check_line(digest, opts, line, len, &file, &file_len, &expected)) {
+			ctx.malformed++;
+			print_malformed_line(from_stdin ? "<stdin>" : opts->check, reader.line_num);
+			continue;
+		}
+		if (!check_batch_add(batch, file, file_len, &expected)) {
+			result = set_error(E_ERRNO, "");
+			goto cleanup;
+		}
+		if (batch->files.count == DIGEST_FILE_BATCH && exec_file_batch(digest, &batch->files, opts, &report_check_job, &ctx) != OK) {
+			result = propagate_error();
+			goto cleanup;
+		}
+	}
+	if (batch->files.count > 0 && exec_file_batch(digest, &batch->files, opts, &report_check_job, &ctx) != OK) {
+		result = propagate_error();
+		goto cleanup;
+	}
+
+	if (!opts->quiet || ctx.failed + ctx.unreadable + ctx.malformed > 0) {
+		print_check_summary(&ctx);
+	}
+	if (ctx.failed + ctx.unreadable + ctx.malformed > 0) {
+		set_err_object(from_stdin ? "<stdin>" : opts->check);
+		result = set_error(E_CHECK_FAILED, "Verification failed");
+	}
+
+cleanup:
+	if (batch != NULL) {
+		free(batch->files.names);
+	}
+	free(batch);
+	free(reader.line);
+	free(reader.buffer);
+	if (!from_stdin) {
+		close(fd);
+	}
+	return result;
+}
+
+/// Hashes the regular files under the paths given, a batch at a time, in the order `walk_next` lists them
+/// Directories that can't be read are reported and skipped, like files that can't be opened
+static t_result exec_digest_walk(enum e_digest digest, struct digest_args *const opts) {
+	struct walk_options walk_opts = {
+		.follow_links = opts->follow_links,
+		.one_filesystem = opts->one_filesystem,
+		.threads = opts->jobs > 1 ? opts->jobs : pool_default_threads(),
+	};
+	struct file_batch *batch = malloc(sizeof(*batch));
+	struct walk *walk = NULL;
+	if (batch == NULL) {
+		return set_error(E_ERRNO, "");
+	}
+	*batch = (struct file_batch){ .names = NULL };
+	if (walk_start(&walk, (char const *const *)opts->files, opts->file_num, &walk_opts) != OK) {
+		free(batch);
+		return propagate_error();
+	}
+
+	t_result result = OK;
+	while (result == OK) {
+		char const *path;
+		int err;
+		int status = walk_next(walk, &path, &err);
+		if (status <= 0) {
+			if (status < 0) {
+				reset_err_object();
+				result = set_error(E_ERRNO, "");
+			}
+			break;
+		}
+		if (err != 0) {
+			// The files listed before it are printed first, so the output keeps the order of the walk
+			if (batch->count > 0 && exec_file_batch(digest, batch, opts, &report_digest_job, opts) != OK) {
+				result = propagate_error();
+				break;
+			}
+			errno = err;
+			print_error_local(STDERR_FILENO, NULL, E_ERRNO, path, NULL);
+			continue;
+		}
+		if (!file_batch_add(batch, path, ft_strlen(path))) {
+			reset_err_object();
+			result = set_error(E_ERRNO, "");
+		}
+		else if (batch->count == DIGEST_FILE_BATCH && exec_file_batch(digest, batch, opts, &report_digest_job, opts) != OK) {
+			result = propagate_error();
+		}
+	}
+	if (result == OK && batch->count > 0 && exec_file_batch(digest, batch, opts, &report_digest_job, opts) != OK) {
+		result = propagate_error();
+	}
+
+	walk_finish(walk);
+	free(batch->names);
+	free(batch);
+	return result;
+}
+
+/// Whether the multi-buffer kernel would get `DIGEST_MB_MIN_FILES` files to hash side by side
+static bool mb_can_batch(enum e_digest digest, struct digest_args *const opts) {
+	if (digest_mb(digest) == NULL || opts->tree_chunk != 0 || opts->cache != NULL) {
+		return false;
+	}
+	size_t small = 0;
+	for (size_t i = 0; i < opts->file_num && small < DIGEST_MB_MIN_FILES; i++) {
+		struct stat st;
+		small += stat(opts->files[i], &st) == 0 && S_ISREG(st.st_mode) && st.st_size <= DIGEST_MB_MAX_BYTES;
+	}
+	return small >= DIGEST_MB_MIN_FILES;
+}
+
+static t_result exec_digest_inputs(enum e_digest digest, struct digest_args *const opts) {
+	if (opts->check != NULL) {
+		if (exec_digest_check(digest, opts) != OK) {
+			return propagate_error();
+		}
+		reset_err_object();
+		return OK;
+	}
+
+	if ((opts->file_num == 0 && !opts->string) || opts->print) {
+		set_err_object("<stdin>");
+		if (print_digest_stdin(digest, opts) != OK) {
+			return propagate_error();
+		}
+		reset_err_object();
+	}
+
+	if (opts->string != NULL) {
+		if (print_digest_buf(digest, (uint8_t*)opts->string, ft_strlen(opts->string), opts) != OK) {
+			return propagate_error();
+		}
+	}
+
+	if (opts->recursive && opts->file_num > 0) {
+		if (exec_digest_walk(digest, opts) != OK) {
+			return propagate_error();
+		}
+		reset_err_object();
+		return OK;
+	}
+
+	struct uring_reader *reader = NULL;
+	if (opts->uring && opts->file_num > 0 && opts->tree_chunk == 0 && opts->cache == NULL) {
+		reader = uring_reader_create(DIGEST_URING_DEPTH < opts->file_num ? DIGEST_URING_DEPTH : opts->file_num, DIGEST_STREAM_BYTES);
+	}
+	if (reader != NULL) {
+		t_result result = exec_digest_files_uring(digest, opts, reader);
+		uring_reader_destroy(reader);
+		if (result != OK) {
+			return propagate_error();
+		}
+		reset_err_object();
+		return OK;
+	}
+
+	if (opts->file_num > 1 && (opts->jobs > 1 || mb_can_batch(digest, opts))) {
+		if (exec_digest_files_parallel(digest, (char const *const *)opts->files, opts->file_num, opts->jobs, opts, &report_digest_job, opts) != OK) {
+			return propagate_error();
+		}
+		reset_err_object();
+		return OK;
+	}
+
+	for (size_t i = 0; i < opts->file_num; i++) {
+		set_err_object(opts->files[i]);
+		int fd = open(opts->files[i], O_RDONLY);
+		if (fd < 0) {
+			print_error_local(STDERR_FILENO, NULL, E_ERRNO, NULL, NULL);
+			continue;
+		}
+		if (print_digest_file(digest, fd, opts->files[i], opts) != OK) {
+			print_error(STDERR_FILENO);
+			opts->read_failed = true;
+		}
+		close(fd);
+	}
+	reset_err_object();
+	return OK;
+}
+
+static t_result exec_digest(enum e_digest digest, struct digest_args *const opts) {
+	if (opts->cache_path != NULL && cache_open(&opts->cache, opts->cache_path) != OK) {
+		return propagate_error();
+	}
+	t_result result = exec_digest_inputs(digest, opts);
+	// Files that couldn't be read didn't stop the others, the command still fails
+	if (result == OK && opts->read_failed) {
+		result = set_error(E_REPORTED, NULL);
+	}
+	if (opts->cache != NULL) {
+		cache_close(opts->cache);
+		opts->cache = NULL;
+	}
+	return result;
+}
+
+/// The digests of the `multi` command, every block that is read is fed to all of them
+/// With a pool, each digest hashes its share of a buffer on its own thread
+struct multi_digest {
+	enum e_digest digests[DIGEST_COUNT];
+	size_t count;
+	struct pool *pool;
+	pthread_mutex_t lock;
+	pthread_cond_t all_done;
+	size_t pending;
+};
+
+struct multi_task {
+	struct multi_digest *multi;
+	enum e_digest digest;
+	t_digest_state state;
+	uint8_t const *data;
+	size_t len;
+	bool last;
+	t_digest_hash hash;
+};
+
+/// Command names of the digests, as given to `multi`
+static char const *digest_command(enum e_digest digest) {
+	static char const *const commands[] = {
+		[D_MD5] = "md5",
+		[D_SHA256] = "sha256",
+		[D_WHIRLPOOL] = "whirlpool",
+		[D_SHA384] = "sha384",
+		[D_SHA512] = "sha512",
+		[D_SHA512_256] = "sha512-256",
+		[D_BLAKE3] = "blake3",
+	};
+
+	return commands[digest];
+}
+
+/// Parses a comma-separated list of digest commands, each of them at most once
+static t_result parse_digest_list(char const *list, struct multi_digest *multi) {
+	multi->count = 0;
+	if (list == NULL) {
+		return set_error(E_OPT_MISSING_VALUE, "Expected a comma-separated list of digest commands");
+	}
+	set_err_object(list);
+	while (true) {
+		size_t len = 0;
+		while (list[len] != '\0' && list[len] != ',') {
+			len++;
+		}
+		size_t found = DIGEST_COUNT;
+		for (size_t d = 0; d < DIGEST_COUNT; d++) {
+			char const *command = digest_command(d);
+			if (ft_strlen(command) == len && memcmp(command, list, len) == 0) {
+				found = d;
+			}
+		}
+		if (found == DIGEST_COUNT) {
+			return set_error(E_INVALID_OPT_VALUE, "Expected a comma-separated list of digest commands");
+		}
+		for (size_t i = 0; i < multi->count; i++) {
+			if (multi->digests[i] == found) {
+				return set_error(E_INVALID_OPT_VALUE, "Digest listed twice");
+			}
+		}
+		multi->digests[multi->count++] = found;
+		if (list[len] == '\0') {
+			break;
+		}
+		list += len + 1;
+	}
+	reset_err_object();
+	return OK;
+}
+
+static void feed_multi_task(struct multi_task *task) {
+	size_t block_bytes = digest_block_bytes(task->digest);
+	size_t blocks = task->len / block_bytes;
+	digest_rounds(task->digest, &task->state, task->data, blocks);
+	if (task->last) {
+		task->hash = digest_final_round(task->digest, task->state, task->data + blocks * block_bytes, (task->len % block_bytes) * 8);
+	}
+}
+
+static void run_multi_task(void *arg) {
+	struct multi_task *task = arg;
+	struct multi_digest *multi = task->multi;
+
+	feed_multi_task(task);
+	pthread_mutex_lock(&multi->lock);
+	multi->pending--;
+	if (multi->pending == 0) {
+		pthread_cond_signal(&multi->all_done);
+	}
+	pthread_mutex_unlock(&multi->lock);
+}
+
+/// Feeds `len` bytes to every digest, and waits until they are all done with them
+/// `len` has to be a multiple of every block size, unless it is the `last` part of the input
+static void feed_multi(struct multi_digest *multi, struct multi_task *tasks, uint8_t const *data, size_t len, bool last) {
+	for (size_t i = 0; i < multi->count; i++) {
+		tasks[i].data = data;
+		tasks[i].len = len;
+		tasks[i].last = last;
+	}
+	if (multi->pool == NULL) {
+		for (size_t i = 0; i < multi->count; i++) {
+			feed_multi_task(&tasks[i]);
+		}
+		return;
+	}
+
+	multi->pending = multi->count;
+	for (size_t i = 0; i < multi->count; i++) {
+		if (pool_submit(multi->pool, &run_multi_task, &tasks[i]) != OK) {
+			run_multi_task(&tasks[i]);
+		}
+	}
+	reset_error();
+	pthread_mutex_lock(&multi->lock);
+	while (multi->pending > 0) {
+		pthread_cond_wait(&multi->all_done, &multi->lock);
+	}
+	pthread_mutex_unlock(&multi->lock);
+}
+
+/// Reads the rest of the file behind `fd` once, `hashes` gets the hash of every digest of `multi`
+/// Returns 0 on success, or the errno value of the failure
+static int multi_digest_fd(struct multi_digest *multi, int fd, t_digest_hash *hashes) {
+	struct multi_task tasks[DIGEST_COUNT];
+	for (size_t i = 0; i < multi->count; i++) {
+		tasks[i] = (struct multi_task){
+			.multi = multi,
+			.digest = multi->digests[i],
+			.state = digest_state(multi->digests[i]),
+		};
+	}
+
+	struct digest_file_stream stream = file_stream(fd);
+	if (stream.buffer == NULL && stream.pipeline == NULL) {
+		return ENOMEM;
+	}
+	int err = 0;
+	while (true) {
+		ssize_t nread = read_file_blocks(&stream);
+		if (nread < 0) {
+			err = errno;
+			break;
+		}
+		bool last = (size_t)nread < stream.buffer_size;
+		feed_multi(multi, tasks, stream.buffer, nread, last);
+		if (last) {
+			break;
+		}
+	}
+	file_stream_finish(&stream);
+
+	for (size_t i = 0; i < multi->count && err == 0; i++) {
+		hashes[i] = tasks[i].hash;
+	}
+	return err;
+}
+
+static t_result print_multi_digest_file(struct multi_digest *multi, int fd, char const *filename, struct digest_args *const opts) {
+	t_digest_hash hashes[DIGEST_COUNT];
+	int err = multi_digest_fd(multi, fd, hashes);
+	if (err != 0) {
+		errno = err;
+		return set_error(E_ERRNO, "");
+	}
+	for (size_t i = 0; i < multi->count; i++) {
+		print_digest_line(multi->digests[i], filename, &hashes[i], 0, opts);
+	}
+	return OK;
+}
+
+static t_result exec_multi_digest(struct multi_digest *multi, struct digest_args *const opts) {
+	if (opts->print || opts->uring || opts->unordered || opts->tree_chunk != 0 || opts->check != NULL || opts->cache_path != NULL || opts->recursive) {
+		return set_error(E_UNEXPECTED_OPT, "Only -q, -r, -s and -j can be used with multi");
+	}
+
+	if (opts->file_num == 0 && opts->string == NULL) {
+		set_err_object("<stdin>");
+		if (print_multi_digest_file(multi, STDIN_FILENO, "<stdin>", opts) != OK) {
+			return propagate_error();
+		}
+		reset_err_object();
+	}
+
+	// The string is in memory already, so it is simply hashed by every digest
+	if (opts->string != NULL) {
+		for (size_t i = 0; i < multi->count; i++) {
+			if (print_digest_buf(multi->digests[i], (uint8_t*)opts->string, ft_strlen(opts->string), opts) != OK) {
+				return propagate_error();
+			}
+		}
+	}
+
+	for (size_t i = 0; i < opts->file_num; i++) {
+		set_err_object(opts->files[i]);
+		int fd = open(opts->files[i], O_RDONLY);
+		if (fd < 0) {
+			print_error_local(STDERR_FILENO, NULL, E_ERRNO, NULL, NULL);
+			continue;
+		}
+		if (print_multi_digest_file(multi, fd, opts->files[i], opts) != OK) {
+			print_error(STDERR_FILENO);
+			opts->read_failed = true;
+		}
+		close(fd);
+	}
+	reset_err_object();
+	if (opts->read_failed) {
+		return set_error(E_REPORTED, NULL);
+	}
+	return OK;
+}
+
+t_result md5_digest(char **args) {
+	set_err_prefix("md5");
+	struct digest_args opts;
+	if (
+		parse_digest_args(args, &opts) != OK ||
+		exec_digest(D_MD5, &opts) != OK
+	) {
+		print_error(STDERR_FILENO);
+		exit(1);
+	}
+	reset_err_prefix();
+	return reset_error();
+}
+
+t_result sha256_digest(char **args) {
+	set_err_prefix("sha256");
 	struct digest_args opts;
 	if (
 		parse_digest_args(args, &opts) != OK ||
@@ -357,3 +2168,86 @@ t_result whirlpool_digest(char **args) {
 	reset_err_prefix();
 	return reset_error();
 }
+
+t_result sha384_digest(char **args) {
+	set_err_prefix("sha384");
+	struct digest_args opts;
+	if (
+		parse_digest_args(args, &opts) != OK ||
+		exec_digest(D_SHA384, &opts) != OK
+	) {
+		print_error(STDERR_FILENO);
+		exit(1);
+	}
+	reset_err_prefix();
+	return reset_error();
+}
+
+t_result sha512_digest(char **args) {
+	set_err_prefix("sha512");
+	struct digest_args opts;
+	if (
+		parse_digest_args(args, &opts) != OK ||
+		exec_digest(D_SHA512, &opts) != OK
+	) {
+		print_error(STDERR_FILENO);
+		exit(1);
+	}
+	reset_err_prefix();
+	return reset_error();
+}
+
+t_result sha512_256_digest(char **args) {
+	set_err_prefix("sha512-256");
+	struct digest_args opts;
+	if (
+		parse_digest_args(args, &opts) != OK ||
+		exec_digest(D_SHA512_256, &opts) != OK
+	) {
+		print_error(STDERR_FILENO);
+		exit(1);
+	}
+	reset_err_prefix();
+	return reset_error();
+}
+
+t_result blake3_digest(char **args) {
+	set_err_prefix("blake3");
+	struct digest_args opts;
+	if (
+		parse_digest_args(args, &opts) != OK ||
+		exec_digest(D_BLAKE3, &opts) != OK
+	) {
+		print_error(STDERR_FILENO);
+		exit(1);
+	}
+	reset_err_prefix();
+	return reset_error();
+}
+
+/// `multi ALG,ALG,... [options] [files]`, reads every input once for all the listed digests
+/// With -j, the digests run on separate threads
+t_result multi_digest(char **args) {
+	set_err_prefix("multi");
+	struct multi_digest multi = {
+		.pool = NULL,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.all_done = PTHREAD_COND_INITIALIZER,
+	};
+	struct digest_args opts;
+
+	if (
+		parse_digest_list(args[0], &multi) != OK ||
+		parse_digest_args(&args[1], &opts) != OK ||
+		(opts.jobs > 1 && multi.count > 1 && pool_start(&multi.pool, opts.jobs < multi.count ? opts.jobs : multi.count) != OK) ||
+		exec_multi_digest(&multi, &opts) != OK
+	) {
+		print_error(STDERR_FILENO);
+		exit(1);
+	}
+	if (multi.pool != NULL) {
+		pool_finish(multi.pool);
+	}
+	reset_err_prefix();
+	return reset_error();
+}
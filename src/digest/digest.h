@@ -5,3 +5,8 @@
 t_result md5_digest(char **args);
 t_result sha256_digest(char **args);
 t_result whirlpool_digest(char **args);
+t_result sha384_digest(char **args);
+t_result sha512_digest(char **args);
+t_result sha512_256_digest(char **args);
+t_result blake3_digest(char **args);
+t_result multi_digest(char **args);
@@ -18,6 +18,14 @@ struct hash256_hex {
 	char hex[65];
 };
 
+struct hash384 {
+	uint8_t hash[48]; // stored in big-endian
+};
+
+struct hash384_hex {
+	char hex[97];
+};
+
 struct hash512 {
 	uint8_t hash[64]; // stored in big-endian
 };
@@ -28,4 +36,5 @@ struct hash512_hex {
 
 struct hash128_hex hash128_hex(struct hash128 const *hash);
 struct hash256_hex hash256_hex(struct hash256 const *hash);
+struct hash384_hex hash384_hex(struct hash384 const *hash);
 struct hash512_hex hash512_hex(struct hash512 const *hash);
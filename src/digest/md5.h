@@ -1,9 +1,12 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "hash.h"
 
+struct mb_algorithm;
+
 struct md5_state {
 	uint32_t a;
 	uint32_t b;
@@ -19,6 +22,21 @@ struct md5_state md5_state(void);
 /// `m` should be a block of 64 bytes (512 bits)
 struct md5_state md5_round(struct md5_state state, uint8_t const m[64]);
 
+/// `m` should have a consistent order of bytes (endianness) on different hosts
+/// `m` should be `blocks` consecutive blocks of 64 bytes (512 bits)
+void md5_rounds(struct md5_state *state, uint8_t const *m, size_t blocks);
+
 /// `m` should have a consistent order of bytes (endianness) on different hosts
 /// `m` should be a block of 64 bytes (512 bits)
 struct hash128 md5_final_round(struct md5_state state, uint8_t const m[64], uint16_t bits);
+
+/// Writes the end of a message followed by its padding to `tail`, returns the amount of blocks written (1 or 2)
+/// `m` should have a consistent order of bytes (endianness) on different hosts
+/// `m` holds the last `bits` bits of a message of `total_bits` bits, less than a block
+size_t md5_padding(uint8_t tail[128], uint8_t const *m, uint16_t bits, uint64_t total_bits);
+
+/// Hashes 16 independent messages at once with AVX-512 or 8 with AVX2, NULL when the cpu has neither
+struct mb_algorithm const *md5_mb(void);
+
+/// The `index`th multi-buffer kernel the cpu can run, `md5_mb` picks the first one, NULL past the last
+struct mb_algorithm const *md5_mb_kernel(size_t index);
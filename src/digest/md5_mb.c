@@ -0,0 +1,166 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+#include "endianness.h"
+#include "md5.h"
+#include "md5_steps.h"
+#include "multibuffer.h"
+#include "utils.h"
+
+// The kernels gather from the array of block pointers loaded as 64-bit lanes, so pointers have to be 8 bytes
+#if defined(__x86_64__)
+# include <immintrin.h>
+
+static uint32_t const md5_iv[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+
+static void init_lane(uint32_t *states, size_t lanes, size_t lane) {
+	for (size_t i = 0; i < 4; i++) {
+		states[i * lanes + lane] = md5_iv[i];
+	}
+}
+
+static void finish_lane(uint32_t const *states, size_t lanes, size_t lane, struct hash128 *hash) {
+	for (size_t i = 0; i < 4; i++) {
+		uint32_t word = host_to_little32(states[i * lanes + lane]);
+		ft_memcpy(hash->hash + i * 4, &word, sizeof(word));
+	}
+}
+
+# define AVX2 __attribute__((target("avx2")))
+# define AVX512 __attribute__((target("avx2,avx512f")))
+
+static void init_lane_avx2(uint32_t *states, size_t lane) {
+	init_lane(states, 8, lane);
+}
+
+static void finish_lane_avx2(uint32_t const *states, size_t lane, void *hash) {
+	finish_lane(states, 8, lane, hash);
+}
+
+# define F256(b, c, d) _mm256_xor_si256((d), _mm256_and_si256((b), _mm256_xor_si256((c), (d))))
+# define G256(b, c, d) _mm256_xor_si256((c), _mm256_and_si256((d), _mm256_xor_si256((b), (c))))
+# define H256(b, c, d) _mm256_xor_si256(_mm256_xor_si256((b), (c)), (d))
+# define I256(b, c, d) _mm256_xor_si256((c), _mm256_or_si256((b), _mm256_xor_si256((d), ones)))
+
+# define STEP256(f, a, b, c, d, g, s, k) { \
+	__m256i sum = _mm256_add_epi32(_mm256_add_epi32((a), f##256((b), (c), (d))), _mm256_add_epi32(m[g], _mm256_set1_epi32((int)(k)))); \
+	(a) = _mm256_add_epi32((b), _mm256_or_si256(_mm256_slli_epi32(sum, (s)), _mm256_srli_epi32(sum, 32 - (s)))); \
+}
+
+/// Every lane's block is read one word at a time, gathering it from all 8 blocks
+AVX2 static void kernel_avx2(uint32_t *states, uint8_t const *const *blocks) {
+	__m256i const lo = _mm256_loadu_si256((__m256i const *)&blocks[0]);
+	__m256i const hi = _mm256_loadu_si256((__m256i const *)&blocks[4]);
+	__m256i const ones = _mm256_set1_epi32(-1);
+	__m256i m[16];
+	for (size_t i = 0; i < 16; i++) {
+		__m256i offset = _mm256_set1_epi64x(i * 4);
+		__m128i words_lo = _mm256_i64gather_epi32(NULL, _mm256_add_epi64(lo, offset), 1);
+		__m128i words_hi = _mm256_i64gather_epi32(NULL, _mm256_add_epi64(hi, offset), 1);
+		m[i] = _mm256_inserti128_si256(_mm256_castsi128_si256(words_lo), words_hi, 1);
+	}
+
+	__m256i *state = (__m256i *)states;
+	__m256i a = _mm256_load_si256(state + 0);
+	__m256i b = _mm256_load_si256(state + 1);
+	__m256i c = _mm256_load_si256(state + 2);
+	__m256i d = _mm256_load_si256(state + 3);
+
+	MD5_STEPS(STEP256)
+
+	_mm256_store_si256(state + 0, _mm256_add_epi32(_mm256_load_si256(state + 0), a));
+	_mm256_store_si256(state + 1, _mm256_add_epi32(_mm256_load_si256(state + 1), b));
+	_mm256_store_si256(state + 2, _mm256_add_epi32(_mm256_load_si256(state + 2), c));
+	_mm256_store_si256(state + 3, _mm256_add_epi32(_mm256_load_si256(state + 3), d));
+}
+
+static void init_lane_avx512(uint32_t *states, size_t lane) {
+	init_lane(states, 16, lane);
+}
+
+static void finish_lane_avx512(uint32_t const *states, size_t lane, void *hash) {
+	finish_lane(states, 16, lane, hash);
+}
+
+// Each function is a single ternary logic instruction, the immediate is its truth table
+# define F512(b, c, d) _mm512_ternarylogic_epi32((b), (c), (d), 0xca)
+# define G512(b, c, d) _mm512_ternarylogic_epi32((d), (b), (c), 0xca)
+# define H512(b, c, d) _mm512_ternarylogic_epi32((b), (c), (d), 0x96)
+# define I512(b, c, d) _mm512_ternarylogic_epi32((b), (c), (d), 0x39)
+
+# define STEP512(f, a, b, c, d, g, s, k) { \
+	__m512i sum = _mm512_add_epi32(_mm512_add_epi32((a), f##512((b), (c), (d))), _mm512_add_epi32(m[g], _mm512_set1_epi32((int)(k)))); \
+	(a) = _mm512_add_epi32((b), _mm512_rol_epi32(sum, (s))); \
+}
+
+AVX512 static void kernel_avx512(uint32_t *states, uint8_t const *const *blocks) {
+	__m512i const lo = _mm512_loadu_si512(&blocks[0]);
+	__m512i const hi = _mm512_loadu_si512(&blocks[8]);
+	__m512i m[16];
+	for (size_t i = 0; i < 16; i++) {
+		__m512i offset = _mm512_set1_epi64(i * 4);
+		__m256i words_lo = _mm512_i64gather_epi32(_mm512_add_epi64(lo, offset), NULL, 1);
+		__m256i words_hi = _mm512_i64gather_epi32(_mm512_add_epi64(hi, offset), NULL, 1);
+		m[i] = _mm512_inserti64x4(_mm512_castsi256_si512(words_lo), words_hi, 1);
+	}
+
+	__m512i *state = (__m512i *)states;
+	__m512i a = _mm512_load_si512(state + 0);
+	__m512i b = _mm512_load_si512(state + 1);
+	__m512i c = _mm512_load_si512(state + 2);
+	__m512i d = _mm512_load_si512(state + 3);
+
+	MD5_STEPS(STEP512)
+
+	_mm512_store_si512(state + 0, _mm512_add_epi32(_mm512_load_si512(state + 0), a));
+	_mm512_store_si512(state + 1, _mm512_add_epi32(_mm512_load_si512(state + 1), b));
+	_mm512_store_si512(state + 2, _mm512_add_epi32(_mm512_load_si512(state + 2), c));
+	_mm512_store_si512(state + 3, _mm512_add_epi32(_mm512_load_si512(state + 3), d));
+}
+
+static struct mb_algorithm const md5_mb_avx2 = {
+	.name = "avx2",
+	.lanes = 8,
+	.kernel = &kernel_avx2,
+	.init_lane = &init_lane_avx2,
+	.finish_lane = &finish_lane_avx2,
+	.padding = &md5_padding,
+};
+
+static struct mb_algorithm const md5_mb_avx512 = {
+	.name = "avx512",
+	.lanes = 16,
+	.kernel = &kernel_avx512,
+	.init_lane = &init_lane_avx512,
+	.finish_lane = &finish_lane_avx512,
+	.padding = &md5_padding,
+};
+
+struct mb_algorithm const *md5_mb(void) {
+	return md5_mb_kernel(0);
+}
+
+struct mb_algorithm const *md5_mb_kernel(size_t index) {
+	struct cpu_features cpu = cpu_features();
+	if (cpu.avx512f && index-- == 0) {
+		return &md5_mb_avx512;
+	}
+	if (cpu.avx2 && index-- == 0) {
+		return &md5_mb_avx2;
+	}
+	return NULL;
+}
+
+#else
+
+struct mb_algorithm const *md5_mb(void) {
+	return NULL;
+}
+
+struct mb_algorithm const *md5_mb_kernel(size_t index) {
+	(void)index;
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,80 @@
+#include <stdbool.h>
+
+#include "multibuffer.h"
+
+#define MB_BLOCK_BYTES 64
+
+struct mb_lane {
+	struct mb_job *job;
+	uint8_t const *next; // next full block of the message
+	size_t full_blocks;  // full blocks left before the padded tail
+	size_t tail_blocks;  // padded blocks after that
+	size_t tail_done;
+	uint8_t tail[2 * MB_BLOCK_BYTES];
+};
+
+/// Lanes without a job still have to be fed something, their state is never read
+static uint8_t const idle_block[MB_BLOCK_BYTES] = {0};
+
+static void assign_lane(struct mb_algorithm const *alg, uint32_t *states, struct mb_lane *lane, size_t index, struct mb_job *job) {
+	size_t full = job->len / MB_BLOCK_BYTES;
+	size_t rest = job->len % MB_BLOCK_BYTES;
+
+	lane->job = job;
+	lane->next = job->data;
+	lane->full_blocks = full;
+	lane->tail_done = 0;
+	lane->tail_blocks = alg->padding(lane->tail, job->data + full * MB_BLOCK_BYTES, rest * 8, (uint64_t)job->len * 8);
+	alg->init_lane(states, index);
+}
+
+/// Returns the block `lane` has to process next and moves past it
+static uint8_t const *take_block(struct mb_lane *lane) {
+	uint8_t const *block;
+	if (lane->full_blocks > 0) {
+		block = lane->next;
+		lane->next += MB_BLOCK_BYTES;
+		lane->full_blocks--;
+	} else {
+		block = lane->tail + lane->tail_done * MB_BLOCK_BYTES;
+		lane->tail_done++;
+	}
+	return block;
+}
+
+void mb_hash_jobs(struct mb_algorithm const *alg, struct mb_job *jobs, size_t job_num) {
+	_Alignas(64) uint32_t states[MB_MAX_STATE_WORDS * MB_MAX_LANES];
+	struct mb_lane lanes[MB_MAX_LANES];
+	uint8_t const *blocks[MB_MAX_LANES];
+	size_t next_job = 0;
+	size_t active = 0;
+
+	for (size_t i = 0; i < alg->lanes; i++) {
+		lanes[i].job = NULL;
+		if (next_job < job_num) {
+			assign_lane(alg, states, &lanes[i], i, &jobs[next_job++]);
+			active++;
+		}
+	}
+
+	while (active > 0) {
+		for (size_t i = 0; i < alg->lanes; i++) {
+			blocks[i] = lanes[i].job != NULL ? take_block(&lanes[i]) : idle_block;
+		}
+		alg->kernel(states, blocks);
+
+		for (size_t i = 0; i < alg->lanes; i++) {
+			struct mb_lane *lane = &lanes[i];
+			if (lane->job == NULL || lane->full_blocks > 0 || lane->tail_done < lane->tail_blocks) {
+				continue;
+			}
+			alg->finish_lane(states, i, lane->job->hash);
+			lane->job = NULL;
+			if (next_job < job_num) {
+				assign_lane(alg, states, lane, i, &jobs[next_job++]);
+			} else {
+				active--;
+			}
+		}
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MB_MAX_LANES 16
+#define MB_MAX_STATE_WORDS 8
+
+/// A hash function that runs one compression on several independent streams ("lanes") at once
+/// The state of all lanes is stored word-major: word `i` of lane `l` is `states[i * lanes + l]`
+struct mb_algorithm {
+	char const *name;
+	size_t lanes;
+
+	/// Compresses the block `blocks[l]` into lane `l`, for every lane
+	void (*kernel)(uint32_t *states, uint8_t const *const *blocks);
+	void (*init_lane)(uint32_t *states, size_t lane);
+	void (*finish_lane)(uint32_t const *states, size_t lane, void *hash);
+
+	/// Writes the padded end of a message (`bits` bits of `m`) to `tail`, returns the amount of blocks written
+	size_t (*padding)(uint8_t tail[128], uint8_t const *m, uint16_t bits, uint64_t total_bits);
+};
+
+struct mb_job {
+	uint8_t const *data;
+	size_t len;
+	void *hash; // the hash is written here once all data is processed
+};
+
+/// Hashes every job, a lane is given the next job as soon as its current one is finished
+void mb_hash_jobs(struct mb_algorithm const *alg, struct mb_job *jobs, size_t job_num);
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "hash.h"
 
+struct mb_algorithm;
+
 struct sha256_state {
 	uint32_t a;
 	uint32_t b;
@@ -23,6 +27,33 @@ struct sha256_state sha256_state(void);
 /// `m` should be a block of 64 bytes (512 bits)
 struct sha256_state sha256_round(struct sha256_state state, uint8_t const m[64]);
 
+/// `m` should have a consistent order of bytes (endianness) on different hosts
+/// `m` should be `blocks` consecutive blocks of 64 bytes (512 bits)
+void sha256_rounds(struct sha256_state *state, uint8_t const *m, size_t blocks);
+
 /// `m` should have a consistent order of bytes (endianness) on different hosts
 /// `m` should be a block of at most 512 bits (64 bytes)
 struct hash256 sha256_final_round(struct sha256_state state, uint8_t const m[64], uint16_t bits);
+
+/// Writes the end of a message followed by its padding to `tail`, returns the amount of blocks written (1 or 2)
+/// `m` should have a consistent order of bytes (endianness) on different hosts
+/// `m` holds the last `bits` bits of a message of `total_bits` bits, less than a block
+size_t sha256_padding(uint8_t tail[128], uint8_t const *m, uint16_t bits, uint64_t total_bits);
+
+typedef void (t_sha256_rounds)(struct sha256_state *state, uint8_t const *m, size_t blocks);
+
+struct sha256_kernel {
+	char const *name;
+	bool (*supported)(void);
+	t_sha256_rounds *rounds;
+};
+
+/// Every implementation of `sha256_rounds` from most to least preferred, terminated by a NULL name
+/// `sha256_rounds` uses the first one the cpu supports
+extern struct sha256_kernel const sha256_kernels[];
+
+/// Hashes 8 independent messages at once with AVX2, NULL when the cpu can't run it or has a faster kernel
+struct mb_algorithm const *sha256_mb(void);
+
+/// The `index`th multi-buffer kernel the cpu can run, even one `sha256_mb` passes over, NULL past the last
+struct mb_algorithm const *sha256_mb_kernel(size_t index);
@@ -0,0 +1,108 @@
+#include "sha256_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+
+# define AVX2 __attribute__((target("avx2")))
+
+# define VROTR(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+
+/// Computes the next 4 schedule words from the previous 16 in `x0` to `x3`, each lane for its own block
+/// The last 2 words depend on the first 2, so `SSIG1` is done in two halves
+AVX2 static __m256i schedule4(__m256i x0, __m256i x1, __m256i x2, __m256i x3) {
+	__m256i w15 = _mm256_alignr_epi8(x1, x0, 4);
+	__m256i w7 = _mm256_alignr_epi8(x3, x2, 4);
+	__m256i s0 = _mm256_xor_si256(_mm256_xor_si256(VROTR(w15, 7), VROTR(w15, 18)), _mm256_srli_epi32(w15, 3));
+	__m256i w = _mm256_add_epi32(_mm256_add_epi32(x0, s0), w7);
+
+	__m256i w2 = _mm256_shuffle_epi32(x3, 0xee);
+	__m256i s1 = _mm256_xor_si256(_mm256_xor_si256(VROTR(w2, 17), VROTR(w2, 19)), _mm256_srli_epi32(w2, 10));
+	w = _mm256_add_epi32(w, _mm256_blend_epi32(s1, _mm256_setzero_si256(), 0xcc));
+
+	w2 = _mm256_shuffle_epi32(w, 0x40);
+	s1 = _mm256_xor_si256(_mm256_xor_si256(VROTR(w2, 17), VROTR(w2, 19)), _mm256_srli_epi32(w2, 10));
+	return _mm256_add_epi32(w, _mm256_blend_epi32(s1, _mm256_setzero_si256(), 0x33));
+}
+
+/// Expands `first` and `second` into their round constants plus message schedule
+/// Both blocks share every instruction, one in each 128-bit lane
+AVX2 static void schedule_blocks(uint32_t kw[2][64], uint8_t const *first, uint8_t const *second) {
+	__m256i const byte_swap = _mm256_setr_epi8(
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	__m256i x[4];
+
+	for (int i = 0; i < 4; i++) {
+		__m128i lo = _mm_loadu_si128((__m128i const *)(first + i * 16));
+		__m128i hi = _mm_loadu_si128((__m128i const *)(second + i * 16));
+		x[i] = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), byte_swap);
+	}
+
+	for (int i = 0; i < 16; i++) {
+		__m256i w = x[i % 4];
+		if (i >= 4) {
+			w = schedule4(x[i % 4], x[(i + 1) % 4], x[(i + 2) % 4], x[(i + 3) % 4]);
+			x[i % 4] = w;
+		}
+		__m256i k = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const *)&sha256_k[i * 4]));
+		__m256i sum = _mm256_add_epi32(w, k);
+		_mm_storeu_si128((__m128i *)&kw[0][i * 4], _mm256_castsi256_si128(sum));
+		_mm_storeu_si128((__m128i *)&kw[1][i * 4], _mm256_extracti128_si256(sum, 1));
+	}
+}
+
+#define PRECOMPUTED(i) (kw[i])
+
+AVX2 static void run_rounds(struct sha256_state *state, uint32_t const kw[64]) {
+	uint32_t a = state->a;
+	uint32_t b = state->b;
+	uint32_t c = state->c;
+	uint32_t d = state->d;
+	uint32_t e = state->e;
+	uint32_t f = state->f;
+	uint32_t g = state->g;
+	uint32_t h = state->h;
+
+	ROUNDS8(0, PRECOMPUTED)
+	ROUNDS8(8, PRECOMPUTED)
+	ROUNDS8(16, PRECOMPUTED)
+	ROUNDS8(24, PRECOMPUTED)
+	ROUNDS8(32, PRECOMPUTED)
+	ROUNDS8(40, PRECOMPUTED)
+	ROUNDS8(48, PRECOMPUTED)
+	ROUNDS8(56, PRECOMPUTED)
+
+	state->a += a;
+	state->b += b;
+	state->c += c;
+	state->d += d;
+	state->e += e;
+	state->f += f;
+	state->g += g;
+	state->h += h;
+}
+
+/// The schedule of the next 2 blocks is computed with vectors, then the scalar rounds consume it,
+/// the out-of-order core overlaps the two because they use different execution units
+AVX2 void sha256_rounds_avx2(struct sha256_state *state, uint8_t const *m, size_t blocks) {
+	_Alignas(32) uint32_t kw[2][64];
+
+	for (size_t i = 0; i < blocks; i += 2) {
+		uint8_t const *first = m + i * 64;
+		bool pair = i + 1 < blocks;
+		schedule_blocks(kw, first, pair ? first + 64 : first);
+		run_rounds(state, kw[0]);
+		if (pair) {
+			run_rounds(state, kw[1]);
+		}
+	}
+	state->msg_len += (uint64_t)blocks * 512;
+}
+
+#else
+
+void sha256_rounds_avx2(struct sha256_state *state, uint8_t const *m, size_t blocks) {
+	sha256_rounds_scalar(state, m, blocks);
+}
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256.h"
+
+/// Round constants, shared by all kernels
+extern uint32_t const sha256_k[64];
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define BSIG0(x) (ROTR((x), 2) ^ ROTR((x), 13) ^ ROTR((x), 22))
+#define BSIG1(x) (ROTR((x), 6) ^ ROTR((x), 11) ^ ROTR((x), 25))
+#define SSIG0(x) (ROTR((x), 7) ^ ROTR((x), 18) ^ ((x) >> 3))
+#define SSIG1(x) (ROTR((x), 17) ^ ROTR((x), 19) ^ ((x) >> 10))
+
+/// Same results as `(e & f) ^ (~e & g)` and `(a & b) ^ (a & c) ^ (b & c)`, in fewer instructions
+#define CH(e, f, g) ((g) ^ ((e) & ((f) ^ (g))))
+#define MAJ(a, b, c) (((a) & (b)) | ((c) & ((a) | (b))))
+
+/// Instead of moving all 8 variables every round, the next round is given them in a rotated order
+/// `KW(i)` is the round constant plus word `i` of the message schedule
+#define ROUND(a, b, c, d, e, f, g, h, i, KW) { \
+	uint32_t temp1 = (h) + BSIG1(e) + CH((e), (f), (g)) + KW(i); \
+	(d) += temp1; \
+	(h) = temp1 + BSIG0(a) + MAJ((a), (b), (c)); \
+}
+
+#define ROUNDS8(i, KW) \
+	ROUND(a, b, c, d, e, f, g, h, (i) + 0, KW) \
+	ROUND(h, a, b, c, d, e, f, g, (i) + 1, KW) \
+	ROUND(g, h, a, b, c, d, e, f, (i) + 2, KW) \
+	ROUND(f, g, h, a, b, c, d, e, (i) + 3, KW) \
+	ROUND(e, f, g, h, a, b, c, d, (i) + 4, KW) \
+	ROUND(d, e, f, g, h, a, b, c, (i) + 5, KW) \
+	ROUND(c, d, e, f, g, h, a, b, (i) + 6, KW) \
+	ROUND(b, c, d, e, f, g, h, a, (i) + 7, KW)
+
+void sha256_rounds_scalar(struct sha256_state *state, uint8_t const *m, size_t blocks);
+
+/// Uses the x86 SHA extensions (`sha256rnds2`, `sha256msg1`, `sha256msg2`)
+void sha256_rounds_shani(struct sha256_state *state, uint8_t const *m, size_t blocks);
+
+/// Computes the message schedule of 2 blocks at a time with AVX2, the rounds stay scalar
+void sha256_rounds_avx2(struct sha256_state *state, uint8_t const *m, size_t blocks);
@@ -0,0 +1,156 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+#include "endianness.h"
+#include "multibuffer.h"
+#include "sha256.h"
+#include "sha256_kernels.h"
+#include "utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+
+# define SHA256_MB_LANES 8
+
+static uint32_t const sha256_iv[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static void init_lane(uint32_t *states, size_t lane) {
+	for (size_t i = 0; i < 8; i++) {
+		states[i * SHA256_MB_LANES + lane] = sha256_iv[i];
+	}
+}
+
+static void finish_lane(uint32_t const *states, size_t lane, void *hash_ptr) {
+	struct hash256 *hash = hash_ptr;
+	for (size_t i = 0; i < 8; i++) {
+		uint32_t word = host_to_big32(states[i * SHA256_MB_LANES + lane]);
+		ft_memcpy(hash->hash + i * 4, &word, sizeof(word));
+	}
+}
+
+# define AVX2 __attribute__((target("avx2")))
+
+# define ROR(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+# define ADD(a, b) _mm256_add_epi32((a), (b))
+# define XOR(a, b) _mm256_xor_si256((a), (b))
+
+/// Loads 8 big-endian words at `offset` of every lane's block, word `i` of all lanes ends up in `w[i]`
+AVX2 static void load_words(__m256i w[8], uint8_t const *const *blocks, size_t offset) {
+	__m256i const bswap = _mm256_setr_epi8(
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	__m256i r[8];
+	for (size_t i = 0; i < 8; i++) {
+		r[i] = _mm256_loadu_si256((__m256i const *)(blocks[i] + offset));
+	}
+
+	// 8x8 transpose: pairs of 32-bit words, then pairs of 64-bit words, then 128-bit halves
+	__m256i t[8];
+	for (size_t i = 0; i < 8; i += 2) {
+		t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+		t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+	}
+	__m256i u[8];
+	for (size_t i = 0; i < 8; i += 4) {
+		u[i + 0] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+		u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+		u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+		u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+	}
+	for (size_t i = 0; i < 4; i++) {
+		w[i] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[i], u[i + 4], 0x20), bswap);
+		w[i + 4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[i], u[i + 4], 0x31), bswap);
+	}
+}
+
+AVX2 static void kernel_avx2(uint32_t *states, uint8_t const *const *blocks) {
+	__m256i w[16];
+	load_words(w, blocks, 0);
+	load_words(w + 8, blocks, 32);
+
+	__m256i *state = (__m256i *)states;
+	__m256i a = _mm256_load_si256(state + 0);
+	__m256i b = _mm256_load_si256(state + 1);
+	__m256i c = _mm256_load_si256(state + 2);
+	__m256i d = _mm256_load_si256(state + 3);
+	__m256i e = _mm256_load_si256(state + 4);
+	__m256i f = _mm256_load_si256(state + 5);
+	__m256i g = _mm256_load_si256(state + 6);
+	__m256i h = _mm256_load_si256(state + 7);
+
+	for (size_t i = 0; i < 64; i++) {
+		if (i >= 16) {
+			__m256i w15 = w[(i + 1) % 16];
+			__m256i w2 = w[(i + 14) % 16];
+			__m256i s0 = XOR(XOR(ROR(w15, 7), ROR(w15, 18)), _mm256_srli_epi32(w15, 3));
+			__m256i s1 = XOR(XOR(ROR(w2, 17), ROR(w2, 19)), _mm256_srli_epi32(w2, 10));
+			w[i % 16] = ADD(ADD(w[i % 16], s0), ADD(w[(i + 9) % 16], s1));
+		}
+
+		__m256i s1 = XOR(XOR(ROR(e, 6), ROR(e, 11)), ROR(e, 25));
+		__m256i choice = XOR(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+		__m256i temp1 = ADD(ADD(h, s1), ADD(choice, ADD(_mm256_set1_epi32((int)sha256_k[i]), w[i % 16])));
+		__m256i s0 = XOR(XOR(ROR(a, 2), ROR(a, 13)), ROR(a, 22));
+		__m256i majority = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+		__m256i temp2 = ADD(s0, majority);
+
+		h = g;
+		g = f;
+		f = e;
+		e = ADD(d, temp1);
+		d = c;
+		c = b;
+		b = a;
+		a = ADD(temp1, temp2);
+	}
+
+	_mm256_store_si256(state + 0, ADD(_mm256_load_si256(state + 0), a));
+	_mm256_store_si256(state + 1, ADD(_mm256_load_si256(state + 1), b));
+	_mm256_store_si256(state + 2, ADD(_mm256_load_si256(state + 2), c));
+	_mm256_store_si256(state + 3, ADD(_mm256_load_si256(state + 3), d));
+	_mm256_store_si256(state + 4, ADD(_mm256_load_si256(state + 4), e));
+	_mm256_store_si256(state + 5, ADD(_mm256_load_si256(state + 5), f));
+	_mm256_store_si256(state + 6, ADD(_mm256_load_si256(state + 6), g));
+	_mm256_store_si256(state + 7, ADD(_mm256_load_si256(state + 7), h));
+}
+
+static struct mb_algorithm const sha256_mb_avx2 = {
+	.name = "avx2",
+	.lanes = SHA256_MB_LANES,
+	.kernel = &kernel_avx2,
+	.init_lane = &init_lane,
+	.finish_lane = &finish_lane,
+	.padding = &sha256_padding,
+};
+
+/// A single SHA-NI stream is faster than 8 AVX2 lanes, so this is only used without it
+struct mb_algorithm const *sha256_mb(void) {
+	struct cpu_features cpu = cpu_features();
+	if (cpu.avx2 && !cpu.sha) {
+		return &sha256_mb_avx2;
+	}
+	return NULL;
+}
+
+struct mb_algorithm const *sha256_mb_kernel(size_t index) {
+	if (cpu_features().avx2 && index == 0) {
+		return &sha256_mb_avx2;
+	}
+	return NULL;
+}
+
+#else
+
+struct mb_algorithm const *sha256_mb(void) {
+	return NULL;
+}
+
+struct mb_algorithm const *sha256_mb_kernel(size_t index) {
+	(void)index;
+	return NULL;
+}
+
+#endif
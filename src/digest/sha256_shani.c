@@ -0,0 +1,69 @@
+#include "sha256_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+
+/// The SHA instructions keep the state in two registers, as ABEF and CDGH
+__attribute__((target("sha,sse4.1")))
+void sha256_rounds_shani(struct sha256_state *state, uint8_t const *m, size_t blocks) {
+	__m128i const byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+
+	__m128i dcba = _mm_set_epi32(state->d, state->c, state->b, state->a);
+	__m128i hgfe = _mm_set_epi32(state->h, state->g, state->f, state->e);
+	__m128i cdab = _mm_shuffle_epi32(dcba, 0xb1);
+	__m128i efgh = _mm_shuffle_epi32(hgfe, 0x1b);
+	__m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+	__m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xf0);
+
+	for (size_t block = 0; block < blocks; block++) {
+		uint8_t const *chunk = m + block * 64;
+		__m128i abef_start = abef;
+		__m128i cdgh_start = cdgh;
+		__m128i msgs[4];
+
+		// Every group does 4 rounds, while the schedule for the groups 3 and 4 ahead is prepared
+#pragma GCC unroll 16
+		for (int i = 0; i < 16; i++) {
+			if (i < 4) {
+				msgs[i] = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)(chunk + i * 16)), byte_swap);
+			}
+			__m128i msg = _mm_add_epi32(msgs[i % 4], _mm_loadu_si128((__m128i const *)&sha256_k[i * 4]));
+			cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+			if (i >= 3 && i < 15) {
+				__m128i w7 = _mm_alignr_epi8(msgs[i % 4], msgs[(i + 3) % 4], 4);
+				msgs[(i + 1) % 4] = _mm_sha256msg2_epu32(_mm_add_epi32(msgs[(i + 1) % 4], w7), msgs[i % 4]);
+			}
+			msg = _mm_shuffle_epi32(msg, 0x0e);
+			abef = _mm_sha256rnds2_epu32(abef, cdgh, msg);
+			if (i >= 1 && i < 13) {
+				msgs[(i + 3) % 4] = _mm_sha256msg1_epu32(msgs[(i + 3) % 4], msgs[i % 4]);
+			}
+		}
+
+		abef = _mm_add_epi32(abef, abef_start);
+		cdgh = _mm_add_epi32(cdgh, cdgh_start);
+	}
+
+	__m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+	__m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+	dcba = _mm_blend_epi16(feba, dchg, 0xf0);
+	hgfe = _mm_alignr_epi8(dchg, feba, 8);
+
+	state->a = _mm_extract_epi32(dcba, 0);
+	state->b = _mm_extract_epi32(dcba, 1);
+	state->c = _mm_extract_epi32(dcba, 2);
+	state->d = _mm_extract_epi32(dcba, 3);
+	state->e = _mm_extract_epi32(hgfe, 0);
+	state->f = _mm_extract_epi32(hgfe, 1);
+	state->g = _mm_extract_epi32(hgfe, 2);
+	state->h = _mm_extract_epi32(hgfe, 3);
+	state->msg_len += (uint64_t)blocks * 512;
+}
+
+#else
+
+void sha256_rounds_shani(struct sha256_state *state, uint8_t const *m, size_t blocks) {
+	sha256_rounds_scalar(state, m, blocks);
+}
+
+#endif
@@ -0,0 +1,222 @@
+#include <assert.h>
+#include <stdalign.h>
+
+#include "endianness.h"
+#include "sha512.h"
+#include "utils.h"
+
+static struct sha512_state state_from(uint64_t const iv[8]) {
+	struct sha512_state state = {
+		.a = iv[0],
+		.b = iv[1],
+		.c = iv[2],
+		.d = iv[3],
+		.e = iv[4],
+		.f = iv[5],
+		.g = iv[6],
+		.h = iv[7],
+
+		.msg_len = {0, 0},
+	};
+
+	return state;
+}
+
+struct sha512_state sha512_state(void) {
+	static uint64_t const iv[8] = {
+		0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+		0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+	};
+	return state_from(iv);
+}
+
+struct sha512_state sha384_state(void) {
+	static uint64_t const iv[8] = {
+		0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL, 0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+		0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL, 0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL,
+	};
+	return state_from(iv);
+}
+
+/// Generated by the SHA-512/t IV generation function of FIPS 180-4 for t = 256
+struct sha512_state sha512_256_state(void) {
+	static uint64_t const iv[8] = {
+		0x22312194fc2bf72cULL, 0x9f555fa3c84c64c2ULL, 0x2393b86b6f53b151ULL, 0x963877195940eabdULL,
+		0x96283ee2a88effe3ULL, 0xbe5e1e2553863992ULL, 0x2b0199fc2c85b8aaULL, 0x0eb72ddc81c52ca2ULL,
+	};
+	return state_from(iv);
+}
+
+static uint64_t const sha512_k[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+#define BSIG0(x) (ROTR((x), 28) ^ ROTR((x), 34) ^ ROTR((x), 39))
+#define BSIG1(x) (ROTR((x), 14) ^ ROTR((x), 18) ^ ROTR((x), 41))
+#define SSIG0(x) (ROTR((x), 1) ^ ROTR((x), 8) ^ ((x) >> 7))
+#define SSIG1(x) (ROTR((x), 19) ^ ROTR((x), 61) ^ ((x) >> 6))
+
+/// Same results as `(e & f) ^ (~e & g)` and `(a & b) ^ (a & c) ^ (b & c)`, in fewer instructions
+#define CH(e, f, g) ((g) ^ ((e) & ((f) ^ (g))))
+#define MAJ(a, b, c) (((a) & (b)) | ((c) & ((a) | (b))))
+
+/// Word `i` of the message schedule plus its round constant, `w` only keeps the last 16 words
+#define LOADED(i) (sha512_k[i] + w[i])
+#define SCHEDULED(i) (sha512_k[i] + (w[(i) & 15] += SSIG1(w[((i) - 2) & 15]) + w[((i) - 7) & 15] + SSIG0(w[((i) - 15) & 15])))
+
+/// Same rotation of the 8 variables as the SHA-256 rounds, with 64-bit words
+#define ROUND(a, b, c, d, e, f, g, h, i, KW) { \
+	uint64_t temp1 = (h) + BSIG1(e) + CH((e), (f), (g)) + KW(i); \
+	(d) += temp1; \
+	(h) = temp1 + BSIG0(a) + MAJ((a), (b), (c)); \
+}
+
+#define ROUNDS8(i, KW) \
+	ROUND(a, b, c, d, e, f, g, h, (i) + 0, KW) \
+	ROUND(h, a, b, c, d, e, f, g, (i) + 1, KW) \
+	ROUND(g, h, a, b, c, d, e, f, (i) + 2, KW) \
+	ROUND(f, g, h, a, b, c, d, e, (i) + 3, KW) \
+	ROUND(e, f, g, h, a, b, c, d, (i) + 4, KW) \
+	ROUND(d, e, f, g, h, a, b, c, (i) + 5, KW) \
+	ROUND(c, d, e, f, g, h, a, b, (i) + 6, KW) \
+	ROUND(b, c, d, e, f, g, h, a, (i) + 7, KW)
+
+/// The blocks are in big-endian
+static void process_chunk(struct sha512_state *state, uint8_t const m[128]) {
+	uint64_t w[16];
+	load_be64x16(w, m);
+
+	uint64_t a = state->a;
+	uint64_t b = state->b;
+	uint64_t c = state->c;
+	uint64_t d = state->d;
+	uint64_t e = state->e;
+	uint64_t f = state->f;
+	uint64_t g = state->g;
+	uint64_t h = state->h;
+
+	ROUNDS8(0, LOADED)
+	ROUNDS8(8, LOADED)
+	ROUNDS8(16, SCHEDULED)
+	ROUNDS8(24, SCHEDULED)
+	ROUNDS8(32, SCHEDULED)
+	ROUNDS8(40, SCHEDULED)
+	ROUNDS8(48, SCHEDULED)
+	ROUNDS8(56, SCHEDULED)
+	ROUNDS8(64, SCHEDULED)
+	ROUNDS8(72, SCHEDULED)
+
+	state->a += a;
+	state->b += b;
+	state->c += c;
+	state->d += d;
+	state->e += e;
+	state->f += f;
+	state->g += g;
+	state->h += h;
+}
+
+/// Adds `bits` to the 128-bit message length
+static void add_msg_len(uint64_t msg_len[2], uint64_t bits) {
+	msg_len[0] += bits;
+	if (msg_len[0] < bits) {
+		msg_len[1]++;
+	}
+}
+
+/// `m` should have a consistent order of bytes (endianness) on different hosts
+/// `m` should be `blocks` consecutive blocks of 128 bytes (1024 bits)
+void sha512_rounds(struct sha512_state *state, uint8_t const *m, size_t blocks) {
+	for (size_t i = 0; i < blocks; i++) {
+		process_chunk(state, m + i * 128);
+	}
+	// Split so that `blocks * 1024` can't overflow
+	state->msg_len[1] += (uint64_t)blocks >> 54;
+	add_msg_len(state->msg_len, (uint64_t)blocks << 10);
+}
+
+static struct sha512_state final_chunk(struct sha512_state state, uint8_t const m[128], uint16_t bits) {
+	assert(bits <= 1024);
+	// Precalculate because msg_len should not include the padding
+	uint64_t total_msg_len[2] = {state.msg_len[0], state.msg_len[1]};
+	add_msg_len(total_msg_len, bits);
+
+	if (bits == 1024) {
+		sha512_rounds(&state, m, 1);
+		bits = 0;
+	}
+	uint8_t partial_byte_index = bits / 8;
+	uint8_t partial_bits = bits % 8;
+	size_t blocks = bits >= 1024 - 128 ? 2 : 1;
+
+	alignas(uint64_t) uint8_t tail[256];
+	for (size_t i = 0; i < sizeof(tail); i++) {
+		tail[i] = 0;
+	}
+	ft_memcpy(tail, m, (bits + 7) / 8);
+	tail[partial_byte_index] &= 0xFF << (8 - partial_bits);
+	tail[partial_byte_index] |= 1 << (8 - partial_bits - 1);
+
+	uint64_t len[2] = {host_to_big64(total_msg_len[1]), host_to_big64(total_msg_len[0])};
+	ft_memcpy(tail + blocks * 128 - sizeof(len), len, sizeof(len));
+
+	sha512_rounds(&state, tail, blocks);
+	state.msg_len[0] = total_msg_len[0];
+	state.msg_len[1] = total_msg_len[1];
+	return state;
+}
+
+/// Writes all 8 words in big-endian, the shorter variants keep the start of it
+static void final_words(struct sha512_state state, uint8_t out[64]) {
+	uint64_t const words[8] = {state.a, state.b, state.c, state.d, state.e, state.f, state.g, state.h};
+	for (uint8_t i = 0; i < 8; i++) {
+		uint64_t word = host_to_big64(words[i]);
+		ft_memcpy(out + i * 8, &word, sizeof(word));
+	}
+}
+
+/// `m` should have a consistent order of bytes (endianness) on different hosts
+/// `m` should be a block of at most 1024 bits (128 bytes)
+struct hash512 sha512_final_round(struct sha512_state state, uint8_t const m[128], uint16_t bits) {
+	struct hash512 hash;
+	final_words(final_chunk(state, m, bits), hash.hash);
+	return hash;
+}
+
+struct hash384 sha384_final_round(struct sha512_state state, uint8_t const m[128], uint16_t bits) {
+	uint8_t words[64];
+	final_words(final_chunk(state, m, bits), words);
+
+	struct hash384 hash;
+	ft_memcpy(hash.hash, words, sizeof(hash.hash));
+	return hash;
+}
+
+struct hash256 sha512_256_final_round(struct sha512_state state, uint8_t const m[128], uint16_t bits) {
+	uint8_t words[64];
+	final_words(final_chunk(state, m, bits), words);
+
+	struct hash256 hash;
+	ft_memcpy(hash.hash, words, sizeof(hash.hash));
+	return hash;
+}
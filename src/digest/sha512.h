@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash.h"
+
+/// Shared by SHA-512, SHA-384 and SHA-512/256, which only differ in their initial values and output length
+struct sha512_state {
+	uint64_t a;
+	uint64_t b;
+	uint64_t c;
+	uint64_t d;
+	uint64_t e;
+	uint64_t f;
+	uint64_t g;
+	uint64_t h;
+
+	uint64_t msg_len[2]; // in bits, least significant word first
+};
+
+struct sha512_state sha512_state(void);
+struct sha512_state sha384_state(void);
+struct sha512_state sha512_256_state(void);
+
+/// `m` should have a consistent order of bytes (endianness) on different hosts
+/// `m` should be `blocks` consecutive blocks of 128 bytes (1024 bits)
+void sha512_rounds(struct sha512_state *state, uint8_t const *m, size_t blocks);
+
+/// `m` should have a consistent order of bytes (endianness) on different hosts
+/// `m` should be a block of at most 1024 bits (128 bytes)
+struct hash512 sha512_final_round(struct sha512_state state, uint8_t const m[128], uint16_t bits);
+
+/// `state` should start from `sha384_state`, see `sha512_final_round`
+struct hash384 sha384_final_round(struct sha512_state state, uint8_t const m[128], uint16_t bits);
+
+/// `state` should start from `sha512_256_state`, see `sha512_final_round`
+struct hash256 sha512_256_final_round(struct sha512_state state, uint8_t const m[128], uint16_t bits);
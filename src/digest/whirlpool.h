@@ -1,15 +1,14 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "hash.h"
 
-struct matrix {
-	uint8_t data[64];
-};
-
+/// The 8x8 byte matrix, byte `x` of row `y` is stored in bits `8x` of `rows[y]`
 struct whirlpool_state {
-	struct matrix matrix;
+	uint64_t rows[8];
 	uint64_t msg_len[4];
 };
 
@@ -19,6 +18,23 @@ struct whirlpool_state whirlpool_state(void);
 /// `m` should be a block of 64 bytes (512 bits)
 struct whirlpool_state whirlpool_round(struct whirlpool_state state, uint8_t const m[64]);
 
+/// `m` should have a consistent order of bytes (endianness) on different hosts
+/// `m` should be `blocks` consecutive blocks of 64 bytes (512 bits)
+void whirlpool_rounds(struct whirlpool_state *state, uint8_t const *m, size_t blocks);
+
 /// `m` should have a consistent order of bytes (endianness) on different hosts
 /// `m` should be a block of at most 512 bits (64 bytes)
 struct hash512 whirlpool_final_round(struct whirlpool_state state, uint8_t const m[64], uint16_t bits);
+
+/// Updates the 8 rows of a state with `blocks` blocks of `m`, the message length is counted by `whirlpool_rounds`
+typedef void (t_whirlpool_rounds)(uint64_t state[8], uint8_t const *m, size_t blocks);
+
+struct whirlpool_kernel {
+	char const *name;
+	bool (*supported)(void);
+	t_whirlpool_rounds *rounds;
+};
+
+/// Every implementation of `whirlpool_rounds` from most to least preferred, terminated by a NULL name
+/// `whirlpool_rounds` uses the first one the cpu supports
+extern struct whirlpool_kernel const whirlpool_kernels[];
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "whirlpool.h"
+
+void whirlpool_rounds_scalar(uint64_t state[8], uint8_t const *m, size_t blocks);
+
+/// Vector-permute kernels: the state stays in registers and byte shuffles (`pshufb`) replace the table lookups,
+/// so no memory access depends on the data
+void whirlpool_rounds_ssse3(uint64_t state[8], uint8_t const *m, size_t blocks);
+void whirlpool_rounds_avx2(uint64_t state[8], uint8_t const *m, size_t blocks);
@@ -0,0 +1,259 @@
+#include "whirlpool_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+
+# include "whirlpool_tables.h"
+
+# define SSSE3 __attribute__((target("ssse3")))
+
+/// The state is 4 registers of 2 rows each, see `tools/whirlpool_tables.c` for the byte layout
+struct vperm_constants {
+	__m128i e;
+	__m128i e_high;
+	__m128i e_inv;
+	__m128i r;
+	__m128i low_nibbles;
+	__m128i poly;
+	__m128i shift[4][4];
+	__m128i rotate[8];
+};
+
+SSSE3 static struct vperm_constants load_constants(void) {
+	struct vperm_constants c = {
+		.e = _mm_loadu_si128((__m128i const *)whirlpool_mini_boxes[0]),
+		.e_high = _mm_loadu_si128((__m128i const *)whirlpool_mini_boxes[1]),
+		.e_inv = _mm_loadu_si128((__m128i const *)whirlpool_mini_boxes[2]),
+		.r = _mm_loadu_si128((__m128i const *)whirlpool_mini_boxes[3]),
+		.low_nibbles = _mm_set1_epi8(0x0f),
+		.poly = _mm_set1_epi8(0x1d),
+	};
+	for (int j = 0; j < 4; j++) {
+		for (int i = 0; i < 4; i++) {
+			c.shift[j][i] = _mm_loadu_si128((__m128i const *)whirlpool_shift_masks[j][i]);
+		}
+	}
+	for (int d = 0; d < 8; d++) {
+		c.rotate[d] = _mm_loadu_si128((__m128i const *)whirlpool_rotate_masks[d]);
+	}
+	return c;
+}
+
+/// The S-box as 5 lookups into 16-byte tables, with the nibbles of each byte as indices
+SSSE3 static inline __m128i substitute(struct vperm_constants const *c, __m128i v) {
+	__m128i lo = _mm_and_si128(v, c->low_nibbles);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), c->low_nibbles);
+	__m128i a = _mm_shuffle_epi8(c->e, hi);
+	__m128i b = _mm_shuffle_epi8(c->e_inv, lo);
+	__m128i r = _mm_shuffle_epi8(c->r, _mm_xor_si128(a, b));
+	return _mm_or_si128(_mm_shuffle_epi8(c->e_high, _mm_xor_si128(a, r)), _mm_shuffle_epi8(c->e_inv, _mm_xor_si128(b, r)));
+}
+
+/// Multiplies every byte by 2 in GF(2^8)
+SSSE3 static inline __m128i xtime(struct vperm_constants const *c, __m128i v) {
+	__m128i carry = _mm_cmpgt_epi8(_mm_setzero_si128(), v);
+	return _mm_xor_si128(_mm_add_epi8(v, v), _mm_and_si128(carry, c->poly));
+}
+
+/// Row mixing: byte `x` becomes the sum of `C[d] * row[x - d]` with C = {1, 1, 4, 1, 8, 5, 2, 9},
+/// grouped by multiplier as `A + 2 * (B + 2 * (C + 2 * D))`
+SSSE3 static inline __m128i mix_rows(struct vperm_constants const *c, __m128i v) {
+	__m128i r1 = _mm_shuffle_epi8(v, c->rotate[1]);
+	__m128i r2 = _mm_shuffle_epi8(v, c->rotate[2]);
+	__m128i r3 = _mm_shuffle_epi8(v, c->rotate[3]);
+	__m128i r4 = _mm_shuffle_epi8(v, c->rotate[4]);
+	__m128i r5 = _mm_shuffle_epi8(v, c->rotate[5]);
+	__m128i r6 = _mm_shuffle_epi8(v, c->rotate[6]);
+	__m128i r7 = _mm_shuffle_epi8(v, c->rotate[7]);
+
+	__m128i a = _mm_xor_si128(_mm_xor_si128(v, r1), _mm_xor_si128(_mm_xor_si128(r3, r5), r7));
+	__m128i x2 = _mm_xor_si128(r2, r5);
+	__m128i x3 = _mm_xor_si128(r4, r7);
+	__m128i res = xtime(c, x3);
+	res = xtime(c, _mm_xor_si128(x2, res));
+	res = xtime(c, _mm_xor_si128(r6, res));
+	return _mm_xor_si128(a, res);
+}
+
+/// S-box, column shift and row mixing of all 4 registers, then adds `key`
+SSSE3 static inline void round_function(struct vperm_constants const *c, __m128i x[4], __m128i const key[4]) {
+	__m128i s[4];
+	for (int i = 0; i < 4; i++) {
+		s[i] = substitute(c, x[i]);
+	}
+	for (int j = 0; j < 4; j++) {
+		__m128i shifted = _mm_or_si128(
+			_mm_or_si128(_mm_shuffle_epi8(s[0], c->shift[j][0]), _mm_shuffle_epi8(s[1], c->shift[j][1])),
+			_mm_or_si128(_mm_shuffle_epi8(s[2], c->shift[j][2]), _mm_shuffle_epi8(s[3], c->shift[j][3])));
+		x[j] = _mm_xor_si128(mix_rows(c, shifted), key[j]);
+	}
+}
+
+SSSE3 void whirlpool_rounds_ssse3(uint64_t state[8], uint8_t const *m, size_t blocks) {
+	struct vperm_constants const c = load_constants();
+	__m128i const zero[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+	__m128i h[4];
+	for (int j = 0; j < 4; j++) {
+		h[j] = _mm_loadu_si128((__m128i const *)(state + j * 2));
+	}
+
+	for (size_t block = 0; block < blocks; block++) {
+		__m128i msg[4];
+		__m128i key[4];
+		__m128i s[4];
+		for (int j = 0; j < 4; j++) {
+			msg[j] = _mm_loadu_si128((__m128i const *)(m + block * 64 + j * 16));
+			key[j] = h[j];
+			s[j] = _mm_xor_si128(msg[j], key[j]);
+		}
+
+		for (int r = 0; r < 10; r++) {
+			round_function(&c, key, zero);
+			key[0] = _mm_xor_si128(key[0], _mm_loadl_epi64((__m128i const *)&whirlpool_rc[r]));
+			round_function(&c, s, key);
+		}
+
+		for (int j = 0; j < 4; j++) {
+			h[j] = _mm_xor_si128(h[j], _mm_xor_si128(s[j], msg[j]));
+		}
+	}
+
+	for (int j = 0; j < 4; j++) {
+		_mm_storeu_si128((__m128i *)(state + j * 2), h[j]);
+	}
+}
+
+# define AVX2 __attribute__((target("avx2")))
+
+/// The same kernel on 2 registers of 4 rows each, the column shift is the only step that crosses 128-bit lanes
+struct vperm_constants_avx2 {
+	__m256i e;
+	__m256i e_high;
+	__m256i e_inv;
+	__m256i r;
+	__m256i low_nibbles;
+	__m256i poly;
+	__m256i shift[2][4]; // applied to: both registers, then both with their lanes swapped
+	__m256i rotate[8];
+};
+
+AVX2 static __m256i load_pair(uint8_t const lo[16], uint8_t const hi[16]) {
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((__m128i const *)lo)), _mm_loadu_si128((__m128i const *)hi), 1);
+}
+
+AVX2 static struct vperm_constants_avx2 load_constants_avx2(void) {
+	struct vperm_constants_avx2 c = {
+		.e = load_pair(whirlpool_mini_boxes[0], whirlpool_mini_boxes[0]),
+		.e_high = load_pair(whirlpool_mini_boxes[1], whirlpool_mini_boxes[1]),
+		.e_inv = load_pair(whirlpool_mini_boxes[2], whirlpool_mini_boxes[2]),
+		.r = load_pair(whirlpool_mini_boxes[3], whirlpool_mini_boxes[3]),
+		.low_nibbles = _mm256_set1_epi8(0x0f),
+		.poly = _mm256_set1_epi8(0x1d),
+	};
+	// Lane 0 of output `j` is 16-byte register `2j`, lane 1 is `2j + 1`
+	for (int j = 0; j < 2; j++) {
+		uint8_t const (*lo)[16] = whirlpool_shift_masks[j * 2];
+		uint8_t const (*hi)[16] = whirlpool_shift_masks[j * 2 + 1];
+		c.shift[j][0] = load_pair(lo[0], hi[1]);
+		c.shift[j][1] = load_pair(lo[2], hi[3]);
+		c.shift[j][2] = load_pair(lo[1], hi[0]);
+		c.shift[j][3] = load_pair(lo[3], hi[2]);
+	}
+	for (int d = 0; d < 8; d++) {
+		c.rotate[d] = load_pair(whirlpool_rotate_masks[d], whirlpool_rotate_masks[d]);
+	}
+	return c;
+}
+
+AVX2 static inline __m256i substitute_avx2(struct vperm_constants_avx2 const *c, __m256i v) {
+	__m256i lo = _mm256_and_si256(v, c->low_nibbles);
+	__m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), c->low_nibbles);
+	__m256i a = _mm256_shuffle_epi8(c->e, hi);
+	__m256i b = _mm256_shuffle_epi8(c->e_inv, lo);
+	__m256i r = _mm256_shuffle_epi8(c->r, _mm256_xor_si256(a, b));
+	return _mm256_or_si256(_mm256_shuffle_epi8(c->e_high, _mm256_xor_si256(a, r)), _mm256_shuffle_epi8(c->e_inv, _mm256_xor_si256(b, r)));
+}
+
+AVX2 static inline __m256i xtime_avx2(struct vperm_constants_avx2 const *c, __m256i v) {
+	__m256i carry = _mm256_cmpgt_epi8(_mm256_setzero_si256(), v);
+	return _mm256_xor_si256(_mm256_add_epi8(v, v), _mm256_and_si256(carry, c->poly));
+}
+
+AVX2 static inline __m256i mix_rows_avx2(struct vperm_constants_avx2 const *c, __m256i v) {
+	__m256i r1 = _mm256_shuffle_epi8(v, c->rotate[1]);
+	__m256i r2 = _mm256_shuffle_epi8(v, c->rotate[2]);
+	__m256i r3 = _mm256_shuffle_epi8(v, c->rotate[3]);
+	__m256i r4 = _mm256_shuffle_epi8(v, c->rotate[4]);
+	__m256i r5 = _mm256_shuffle_epi8(v, c->rotate[5]);
+	__m256i r6 = _mm256_shuffle_epi8(v, c->rotate[6]);
+	__m256i r7 = _mm256_shuffle_epi8(v, c->rotate[7]);
+
+	__m256i a = _mm256_xor_si256(_mm256_xor_si256(v, r1), _mm256_xor_si256(_mm256_xor_si256(r3, r5), r7));
+	__m256i x2 = _mm256_xor_si256(r2, r5);
+	__m256i x3 = _mm256_xor_si256(r4, r7);
+	__m256i res = xtime_avx2(c, x3);
+	res = xtime_avx2(c, _mm256_xor_si256(x2, res));
+	res = xtime_avx2(c, _mm256_xor_si256(r6, res));
+	return _mm256_xor_si256(a, res);
+}
+
+AVX2 static inline void round_function_avx2(struct vperm_constants_avx2 const *c, __m256i x[2], __m256i const key[2]) {
+	__m256i s[2];
+	__m256i swapped[2];
+	for (int i = 0; i < 2; i++) {
+		s[i] = substitute_avx2(c, x[i]);
+		swapped[i] = _mm256_permute2x128_si256(s[i], s[i], 0x01);
+	}
+	for (int j = 0; j < 2; j++) {
+		__m256i shifted = _mm256_or_si256(
+			_mm256_or_si256(_mm256_shuffle_epi8(s[0], c->shift[j][0]), _mm256_shuffle_epi8(s[1], c->shift[j][1])),
+			_mm256_or_si256(_mm256_shuffle_epi8(swapped[0], c->shift[j][2]), _mm256_shuffle_epi8(swapped[1], c->shift[j][3])));
+		x[j] = _mm256_xor_si256(mix_rows_avx2(c, shifted), key[j]);
+	}
+}
+
+AVX2 void whirlpool_rounds_avx2(uint64_t state[8], uint8_t const *m, size_t blocks) {
+	struct vperm_constants_avx2 const c = load_constants_avx2();
+	__m256i const zero[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+	__m256i h[2];
+	for (int j = 0; j < 2; j++) {
+		h[j] = _mm256_loadu_si256((__m256i const *)(state + j * 4));
+	}
+
+	for (size_t block = 0; block < blocks; block++) {
+		__m256i msg[2];
+		__m256i key[2];
+		__m256i s[2];
+		for (int j = 0; j < 2; j++) {
+			msg[j] = _mm256_loadu_si256((__m256i const *)(m + block * 64 + j * 32));
+			key[j] = h[j];
+			s[j] = _mm256_xor_si256(msg[j], key[j]);
+		}
+
+		for (int r = 0; r < 10; r++) {
+			round_function_avx2(&c, key, zero);
+			key[0] = _mm256_xor_si256(key[0], _mm256_castsi128_si256(_mm_loadl_epi64((__m128i const *)&whirlpool_rc[r])));
+			round_function_avx2(&c, s, key);
+		}
+
+		for (int j = 0; j < 2; j++) {
+			h[j] = _mm256_xor_si256(h[j], _mm256_xor_si256(s[j], msg[j]));
+		}
+	}
+
+	for (int j = 0; j < 2; j++) {
+		_mm256_storeu_si256((__m256i *)(state + j * 4), h[j]);
+	}
+}
+
+#else
+
+void whirlpool_rounds_ssse3(uint64_t state[8], uint8_t const *m, size_t blocks) {
+	whirlpool_rounds_scalar(state, m, blocks);
+}
+
+void whirlpool_rounds_avx2(uint64_t state[8], uint8_t const *m, size_t blocks) {
+	whirlpool_rounds_scalar(state, m, blocks);
+}
+
+#endif
@@ -21,20 +21,80 @@
 #undef bswap_32
 #undef bswap_64
 
+#if BYTE_ORDER != BIG_ENDIAN && BYTE_ORDER != LITTLE_ENDIAN
+# error Unsupported byte order
+#endif
 
-uint16_t byte_swap16(uint16_t n);
-uint32_t byte_swap32(uint32_t n);
-uint64_t byte_swap64(uint64_t n);
-
-uint16_t host_to_little16(uint16_t n);
-uint16_t host_to_big16(uint16_t n);
-uint32_t host_to_little32(uint32_t n);
-uint32_t host_to_big32(uint32_t n);
-uint64_t host_to_little64(uint64_t n);
-uint64_t host_to_big64(uint64_t n);
-uint16_t little_to_host16(uint16_t n);
-uint16_t big_to_host16(uint16_t n);
-uint32_t little_to_host32(uint32_t n);
-uint32_t big_to_host32(uint32_t n);
-uint64_t little_to_host64(uint64_t n);
-uint64_t big_to_host64(uint64_t n);
+// Everything is inline and built on the compiler's byte swap, which is a single instruction on most cpus
+
+static inline uint16_t byte_swap16(uint16_t n) {
+	return __builtin_bswap16(n);
+}
+
+static inline uint32_t byte_swap32(uint32_t n) {
+	return __builtin_bswap32(n);
+}
+
+static inline uint64_t byte_swap64(uint64_t n) {
+	return __builtin_bswap64(n);
+}
+
+#if BYTE_ORDER == LITTLE_ENDIAN
+static inline uint16_t host_to_little16(uint16_t n) { return n; }
+static inline uint16_t host_to_big16(uint16_t n) { return byte_swap16(n); }
+static inline uint32_t host_to_little32(uint32_t n) { return n; }
+static inline uint32_t host_to_big32(uint32_t n) { return byte_swap32(n); }
+static inline uint64_t host_to_little64(uint64_t n) { return n; }
+static inline uint64_t host_to_big64(uint64_t n) { return byte_swap64(n); }
+#else
+static inline uint16_t host_to_little16(uint16_t n) { return byte_swap16(n); }
+static inline uint16_t host_to_big16(uint16_t n) { return n; }
+static inline uint32_t host_to_little32(uint32_t n) { return byte_swap32(n); }
+static inline uint32_t host_to_big32(uint32_t n) { return n; }
+static inline uint64_t host_to_little64(uint64_t n) { return byte_swap64(n); }
+static inline uint64_t host_to_big64(uint64_t n) { return n; }
+#endif
+
+// Converting is its own inverse
+static inline uint16_t little_to_host16(uint16_t n) { return host_to_little16(n); }
+static inline uint16_t big_to_host16(uint16_t n) { return host_to_big16(n); }
+static inline uint32_t little_to_host32(uint32_t n) { return host_to_little32(n); }
+static inline uint32_t big_to_host32(uint32_t n) { return host_to_big32(n); }
+static inline uint64_t little_to_host64(uint64_t n) { return host_to_little64(n); }
+static inline uint64_t big_to_host64(uint64_t n) { return host_to_big64(n); }
+
+/// Reads a 64-byte block as 16 big-endian words, `block` does not have to be aligned
+static inline void load_be32x16(uint32_t w[16], uint8_t const block[64]) {
+	__builtin_memcpy(w, block, 64);
+	for (int i = 0; i < 16; i++) {
+		w[i] = big_to_host32(w[i]);
+	}
+}
+
+/// Reads a 64-byte block as 16 little-endian words, `block` does not have to be aligned
+static inline void load_le32x16(uint32_t w[16], uint8_t const block[64]) {
+	__builtin_memcpy(w, block, 64);
+#if BYTE_ORDER != LITTLE_ENDIAN
+	for (int i = 0; i < 16; i++) {
+		w[i] = byte_swap32(w[i]);
+	}
+#endif
+}
+
+/// Reads a 64-byte block as 8 little-endian words, `block` does not have to be aligned
+static inline void load_le64x8(uint64_t w[8], uint8_t const block[64]) {
+	__builtin_memcpy(w, block, 64);
+#if BYTE_ORDER != LITTLE_ENDIAN
+	for (int i = 0; i < 8; i++) {
+		w[i] = byte_swap64(w[i]);
+	}
+#endif
+}
+
+/// Reads a 128-byte block as 16 big-endian words, `block` does not have to be aligned
+static inline void load_be64x16(uint64_t w[16], uint8_t const block[128]) {
+	__builtin_memcpy(w, block, 128);
+	for (int i = 0; i < 16; i++) {
+		w[i] = big_to_host64(w[i]);
+	}
+}
@@ -78,7 +78,7 @@ t_result set_error(t_error err, char const *err_msg) {
 }
 
 void print_error_advanced(int fd, char const *prefix, t_error err, char const *object, char const *msg) {
-	if (err == E_NONE) {
+	if (err == E_NONE || err == E_REPORTED) {
 		return;
 	}
 
@@ -23,6 +23,9 @@ typedef enum e_error {
 	E_DUPLICATE_OPT,
 	E_OPT_MISSING_VALUE,
 	E_UNEXPECTED_OPT,
+	E_INVALID_OPT_VALUE,
+	E_CHECK_FAILED,
+	E_REPORTED, // the errors were printed as they happened, only the failure status is left
 } t_error;
 
 t_result reset_error(void);
@@ -17,9 +17,26 @@ static void print_help(void) {
 		"md5\n"
 		"sha256\n"
 		"whirlpool\n"
+		"sha384\n"
+		"sha512\n"
+		"sha512-256\n"
+		"blake3\n"
+		"multi ALG,ALG,...   all the listed digests in one read of the input\n"
 		"\n"
 		"Flags:\n"
 		"-p -q -r -s\n"
+		"-j N         hash files on N threads (0: one per cpu), without it files are hashed one at a time,\n"
+		"             unless 2 or more are at most 64K: those are hashed side by side by the multi-buffer kernel\n"
+		"-unordered   with -j or -uring, print results as soon as they are done\n"
+		"-uring       read many files at once through io_uring\n"
+		"-tree CHUNK  hash as a Merkle tree of CHUNK-byte leaves (K, M, G suffixes), in parallel\n"
+		"-leaves      with -tree, also print the amount of leaves\n"
+		"-c FILE      verify the files listed in FILE, in this command's output format or -r's (-: stdin)\n"
+		"-cache PATH  reuse the hashes of unchanged files, stored in PATH\n"
+		"-R           hash the regular files under the directories given, depth first,\n"
+		"             with the entries of each directory sorted by name (a/b/y before a.txt)\n"
+		"-L -P        with -R, follow symlinks in the trees, or skip them (default)\n"
+		"-x           with -R, don't enter directories on other filesystems\n"
 	);
 }
 
@@ -28,6 +45,11 @@ int main(int argc, char **argv) {
 		{ "md5", &md5_digest},
 		{ "sha256", &sha256_digest },
 		{ "whirlpool", &whirlpool_digest },
+		{ "sha384", &sha384_digest },
+		{ "sha512", &sha512_digest },
+		{ "sha512-256", &sha512_256_digest },
+		{ "blake3", &blake3_digest },
+		{ "multi", &multi_digest },
 	};
 
 	if (argc < 2) {
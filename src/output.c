@@ -0,0 +1,138 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "output.h"
+
+/// Amount of output kept before it is written
+#ifndef OUTPUT_BUFFER_BYTES
+# define OUTPUT_BUFFER_BYTES (64 * 1024)
+#endif
+
+/// Times `output_flush_signal` tries to lock the buffers, 1ms apart
+#ifndef OUTPUT_SIGNAL_LOCK_TRIES
+# define OUTPUT_SIGNAL_LOCK_TRIES 100
+#endif
+
+struct output_buffer {
+	int fd;
+	bool line_buffered; // written at the end of every line
+	size_t len;
+	char data[OUTPUT_BUFFER_BYTES];
+};
+
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t output_once = PTHREAD_ONCE_INIT;
+
+static struct output_buffer outputs[] = {
+	{ .fd = STDOUT_FILENO, .line_buffered = false },
+	{ .fd = STDERR_FILENO, .line_buffered = true },
+};
+
+static void init_outputs(void) {
+	// Someone is watching, results should show up as they are done
+	outputs[0].line_buffered = isatty(STDOUT_FILENO);
+	atexit(&output_flush);
+}
+
+/// Writes all of `iov`, after partial writes too
+/// Failures are ignored, like they were when every string had its own write
+static void write_iovecs(int fd, struct iovec *iov, int count) {
+	while (count > 0) {
+		ssize_t written = writev(fd, iov, count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		while (count > 0 && (size_t)written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0) {
+			iov->iov_base = (char *)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+}
+
+/// Writes what is buffered followed by `data` in one syscall, with the lock held
+static void flush_buffer(struct output_buffer *out, void const *data, size_t len) {
+	if (out->len + len == 0) {
+		return;
+	}
+	struct iovec iov[2] = {
+		{ .iov_base = out->data, .iov_len = out->len },
+		{ .iov_base = (void *)data, .iov_len = len },
+	};
+	write_iovecs(out->fd, iov, 2);
+	out->len = 0;
+}
+
+void output_write(int fd, void const *data, size_t len) {
+	int saved_errno = errno;
+	pthread_once(&output_once, &init_outputs);
+	pthread_mutex_lock(&output_lock);
+
+	struct output_buffer *out = NULL;
+	for (size_t i = 0; i < sizeof(outputs) / sizeof(*outputs); i++) {
+		if (outputs[i].fd == fd) {
+			out = &outputs[i];
+		}
+	}
+
+	if (out == NULL) {
+		struct iovec iov = { .iov_base = (void *)data, .iov_len = len };
+		write_iovecs(fd, &iov, 1);
+	}
+	else {
+		// When both go to the same place, the results come before the error that follows them
+		if (fd != STDOUT_FILENO) {
+			flush_buffer(&outputs[0], NULL, 0);
+		}
+		if (out->len + len > OUTPUT_BUFFER_BYTES || (out->line_buffered && memchr(data, '\n', len) != NULL)) {
+			flush_buffer(out, data, len);
+		}
+		else {
+			memcpy(out->data + out->len, data, len);
+			out->len += len;
+		}
+	}
+
+	pthread_mutex_unlock(&output_lock);
+	errno = saved_errno;
+}
+
+void output_flush(void) {
+	int saved_errno = errno;
+	pthread_mutex_lock(&output_lock);
+	for (size_t i = 0; i < sizeof(outputs) / sizeof(*outputs); i++) {
+		flush_buffer(&outputs[i], NULL, 0);
+	}
+	pthread_mutex_unlock(&output_lock);
+	errno = saved_errno;
+}
+
+void output_flush_signal(void) {
+	int saved_errno = errno;
+	// Only trylock, writev and nanosleep, which can be called from a signal handler
+	struct timespec const delay = { .tv_sec = 0, .tv_nsec = 1000 * 1000 };
+	for (int i = 0; i < OUTPUT_SIGNAL_LOCK_TRIES; i++) {
+		if (pthread_mutex_trylock(&output_lock) == 0) {
+			for (size_t j = 0; j < sizeof(outputs) / sizeof(*outputs); j++) {
+				flush_buffer(&outputs[j], NULL, 0);
+			}
+			pthread_mutex_unlock(&output_lock);
+			break;
+		}
+		nanosleep(&delay, NULL);
+	}
+	errno = saved_errno;
+}
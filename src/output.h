@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stddef.h>
+
+/// Output to stdout is buffered, and written together with the write that overflows the buffer,
+/// or at the end of every line when stdout is a terminal
+/// Output to stderr is written at the end of every line, after everything buffered for stdout
+/// Other file descriptors are written to at once
+/// `errno` is left as it was, error messages are printed from it
+void output_write(int fd, void const *data, size_t len);
+
+/// Writes everything that is buffered, this is also done at exit
+void output_flush(void);
+
+/// `output_flush` for signal handlers, before the process is killed by a signal or ends with `_exit`
+/// Gives up when the buffers stay locked, by a thread that can't go on or by the one that got the signal
+void output_flush_signal(void);
@@ -0,0 +1,147 @@
+#include <errno.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "pipeline.h"
+#include "utils.h"
+
+/// Spins before sleeping, a slot is usually filled or emptied again within a few microseconds
+#define PIPELINE_SPINS 1024
+
+struct pipeline_slot {
+	uint8_t *data;
+	ssize_t len;
+	int err;
+};
+
+struct pipeline {
+	int fd;
+	size_t slot_num;
+	size_t slot_size;
+	struct pipeline_slot *slots;
+	uint8_t *buffers;
+	pthread_t reader;
+
+	// Both only ever increase, `produced - consumed` is the amount of filled slots
+	_Alignas(64) _Atomic uint32_t produced;
+	_Alignas(64) _Atomic uint32_t consumed;
+	bool holding; // whether the consumer still holds the slot it got last
+};
+
+static void futex_wait(_Atomic uint32_t *addr, uint32_t value) {
+	syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static void futex_wake(_Atomic uint32_t *addr) {
+	syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+/// Waits until `*addr` is no longer `value`
+static uint32_t wait_change(_Atomic uint32_t *addr, uint32_t value) {
+	uint32_t current;
+	for (size_t i = 0; i < PIPELINE_SPINS; i++) {
+		current = atomic_load_explicit(addr, memory_order_acquire);
+		if (current != value) {
+			return current;
+		}
+	}
+	while ((current = atomic_load_explicit(addr, memory_order_acquire)) == value) {
+		futex_wait(addr, value);
+	}
+	return current;
+}
+
+static void *reader_main(void *arg) {
+	struct pipeline *pipeline = arg;
+	uint32_t produced = 0;
+	uint32_t consumed = atomic_load_explicit(&pipeline->consumed, memory_order_acquire);
+
+	while (true) {
+		while (produced - consumed == pipeline->slot_num) {
+			consumed = wait_change(&pipeline->consumed, consumed);
+		}
+
+		struct pipeline_slot *slot = &pipeline->slots[produced % pipeline->slot_num];
+		slot->len = ft_read_full(pipeline->fd, slot->data, pipeline->slot_size);
+		slot->err = slot->len < 0 ? errno : 0;
+
+		produced++;
+		atomic_store_explicit(&pipeline->produced, produced, memory_order_release);
+		futex_wake(&pipeline->produced);
+
+		if (slot->len < 0 || (size_t)slot->len < pipeline->slot_size) {
+			return NULL;
+		}
+	}
+}
+
+bool pipeline_start(struct pipeline **pipeline_ptr, int fd, size_t slots, size_t slot_size) {
+	struct pipeline *pipeline = malloc(sizeof(*pipeline));
+	if (pipeline == NULL) {
+		return false;
+	}
+	*pipeline = (struct pipeline){
+		.fd = fd,
+		.slot_num = slots,
+		.slot_size = slot_size,
+		.slots = malloc(slots * sizeof(*pipeline->slots)),
+		.buffers = malloc(slots * slot_size),
+		.holding = false,
+	};
+	atomic_init(&pipeline->produced, 0);
+	atomic_init(&pipeline->consumed, 0);
+	if (pipeline->slots == NULL || pipeline->buffers == NULL) {
+		free(pipeline->buffers);
+		free(pipeline->slots);
+		free(pipeline);
+		return false;
+	}
+	for (size_t i = 0; i < slots; i++) {
+		pipeline->slots[i].data = pipeline->buffers + i * slot_size;
+	}
+
+	int err = pthread_create(&pipeline->reader, NULL, &reader_main, pipeline);
+	if (err != 0) {
+		free(pipeline->buffers);
+		free(pipeline->slots);
+		free(pipeline);
+		errno = err;
+		return false;
+	}
+	*pipeline_ptr = pipeline;
+	return true;
+}
+
+ssize_t pipeline_next(struct pipeline *pipeline, uint8_t **data) {
+	uint32_t consumed = atomic_load_explicit(&pipeline->consumed, memory_order_relaxed);
+	if (pipeline->holding) {
+		consumed++;
+		atomic_store_explicit(&pipeline->consumed, consumed, memory_order_release);
+		futex_wake(&pipeline->consumed);
+	}
+
+	uint32_t produced = atomic_load_explicit(&pipeline->produced, memory_order_acquire);
+	if (produced == consumed) {
+		wait_change(&pipeline->produced, produced);
+	}
+
+	struct pipeline_slot *slot = &pipeline->slots[consumed % pipeline->slot_num];
+	pipeline->holding = true;
+	*data = slot->data;
+	if (slot->len < 0) {
+		errno = slot->err;
+	}
+	return slot->len;
+}
+
+void pipeline_finish(struct pipeline *pipeline) {
+	pthread_join(pipeline->reader, NULL);
+	free(pipeline->buffers);
+	free(pipeline->slots);
+	free(pipeline);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+struct pipeline;
+
+/// Starts a thread that reads `fd` ahead of the caller into `slots` buffers of `slot_size` bytes
+/// The reader and the caller share the buffers through a lock-free single-producer/single-consumer ring
+/// Returns false with errno set on failure, this does not touch the error state so any thread can use it
+bool pipeline_start(struct pipeline **pipeline, int fd, size_t slots, size_t slot_size);
+
+/// Waits for the next filled buffer, it stays valid until the next call
+/// Returns the amount of bytes in it, which is only less than `slot_size` at the end of the file,
+/// or -1 with errno set when reading failed
+ssize_t pipeline_next(struct pipeline *pipeline, uint8_t **data);
+
+/// Must only be called after `pipeline_next` returned the end of the file or an error
+void pipeline_finish(struct pipeline *pipeline);
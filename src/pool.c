@@ -0,0 +1,223 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "pool.h"
+
+struct pool_task {
+	t_pool_fn *fn;
+	void *arg;
+};
+
+/// Growable ring buffer of tasks, the owner takes from the front, thieves from the back
+struct pool_queue {
+	pthread_mutex_t lock;
+	struct pool_task *tasks;
+	size_t capacity;
+	size_t head;
+	size_t len;
+};
+
+struct pool_worker {
+	struct pool *pool;
+	size_t index;
+	pthread_t thread;
+};
+
+struct pool {
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	size_t pending;
+	bool finishing;
+
+	size_t threads;
+	size_t next_queue;
+	struct pool_queue *queues;
+	struct pool_worker *workers;
+};
+
+static bool queue_push_back(struct pool_queue *queue, struct pool_task task) {
+	pthread_mutex_lock(&queue->lock);
+	if (queue->len == queue->capacity) {
+		size_t capacity = queue->capacity == 0 ? 64 : queue->capacity * 2;
+		struct pool_task *tasks = malloc(capacity * sizeof(*tasks));
+		if (tasks == NULL) {
+			pthread_mutex_unlock(&queue->lock);
+			return false;
+		}
+		for (size_t i = 0; i < queue->len; i++) {
+			tasks[i] = queue->tasks[(queue->head + i) % queue->capacity];
+		}
+		free(queue->tasks);
+		queue->tasks = tasks;
+		queue->capacity = capacity;
+		queue->head = 0;
+	}
+	queue->tasks[(queue->head + queue->len) % queue->capacity] = task;
+	queue->len++;
+	pthread_mutex_unlock(&queue->lock);
+	return true;
+}
+
+static bool queue_pop_front(struct pool_queue *queue, struct pool_task *task) {
+	pthread_mutex_lock(&queue->lock);
+	bool popped = queue->len > 0;
+	if (popped) {
+		*task = queue->tasks[queue->head];
+		queue->head = (queue->head + 1) % queue->capacity;
+		queue->len--;
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return popped;
+}
+
+static bool queue_pop_back(struct pool_queue *queue, struct pool_task *task) {
+	pthread_mutex_lock(&queue->lock);
+	bool popped = queue->len > 0;
+	if (popped) {
+		queue->len--;
+		*task = queue->tasks[(queue->head + queue->len) % queue->capacity];
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return popped;
+}
+
+static bool take_task(struct pool *pool, size_t index, struct pool_task *task) {
+	if (queue_pop_front(&pool->queues[index], task)) {
+		return true;
+	}
+	for (size_t i = 1; i < pool->threads; i++) {
+		if (queue_pop_back(&pool->queues[(index + i) % pool->threads], task)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void *worker_main(void *arg) {
+	struct pool_worker *worker = arg;
+	struct pool *pool = worker->pool;
+
+	while (true) {
+		struct pool_task task;
+		if (take_task(pool, worker->index, &task)) {
+			pthread_mutex_lock(&pool->lock);
+			pool->pending--;
+			pthread_mutex_unlock(&pool->lock);
+			task.fn(task.arg);
+			continue;
+		}
+
+		pthread_mutex_lock(&pool->lock);
+		while (pool->pending == 0 && !pool->finishing) {
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		}
+		bool done = pool->pending == 0 && pool->finishing;
+		pthread_mutex_unlock(&pool->lock);
+		if (done) {
+			return NULL;
+		}
+	}
+}
+
+static void pool_free(struct pool *pool, size_t started) {
+	pthread_mutex_lock(&pool->lock);
+	pool->finishing = true;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (size_t i = 0; i < started; i++) {
+		pthread_join(pool->workers[i].thread, NULL);
+	}
+	for (size_t i = 0; i < pool->threads; i++) {
+		pthread_mutex_destroy(&pool->queues[i].lock);
+		free(pool->queues[i].tasks);
+	}
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->queues);
+	free(pool->workers);
+	free(pool);
+}
+
+t_result pool_start(struct pool **pool_ptr, size_t threads) {
+	struct pool *pool = malloc(sizeof(*pool));
+	if (pool == NULL) {
+		return set_error(E_ERRNO, "");
+	}
+	*pool = (struct pool){
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.wake = PTHREAD_COND_INITIALIZER,
+		.threads = threads,
+		.queues = calloc(threads, sizeof(*pool->queues)),
+		.workers = calloc(threads, sizeof(*pool->workers)),
+	};
+	if (pool->queues == NULL || pool->workers == NULL) {
+		free(pool->queues);
+		free(pool->workers);
+		free(pool);
+		return set_error(E_ERRNO, "");
+	}
+	for (size_t i = 0; i < threads; i++) {
+		pthread_mutex_init(&pool->queues[i].lock, NULL);
+	}
+
+	for (size_t i = 0; i < threads; i++) {
+		pool->workers[i] = (struct pool_worker){
+			.pool = pool,
+			.index = i,
+		};
+		int err = pthread_create(&pool->workers[i].thread, NULL, &worker_main, &pool->workers[i]);
+		if (err != 0) {
+			pool_free(pool, i);
+			errno = err;
+			return set_error(E_ERRNO, "");
+		}
+	}
+
+	*pool_ptr = pool;
+	return OK;
+}
+
+t_result pool_submit(struct pool *pool, t_pool_fn *fn, void *arg) {
+	struct pool_task task = {
+		.fn = fn,
+		.arg = arg,
+	};
+
+	// `pending` is raised before the task is queued so it never drops below the amount of queued tasks
+	pthread_mutex_lock(&pool->lock);
+	size_t index = pool->next_queue;
+	pool->next_queue = (pool->next_queue + 1) % pool->threads;
+	pool->pending++;
+	pthread_mutex_unlock(&pool->lock);
+
+	bool queued = queue_push_back(&pool->queues[index], task);
+
+	pthread_mutex_lock(&pool->lock);
+	if (queued) {
+		pthread_cond_signal(&pool->wake);
+	}
+	else {
+		pool->pending--;
+	}
+	pthread_mutex_unlock(&pool->lock);
+	if (!queued) {
+		return set_error(E_ERRNO, "");
+	}
+	return OK;
+}
+
+void pool_finish(struct pool *pool) {
+	pool_free(pool, pool->threads);
+}
+
+size_t pool_default_threads(void) {
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads < 1) {
+		return 1;
+	}
+	return threads;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "error.h"
+
+typedef void (t_pool_fn)(void *arg);
+
+struct pool;
+
+/// Starts `threads` workers, each with its own queue of tasks
+/// Idle workers steal tasks from the back of other workers' queues
+t_result pool_start(struct pool **pool, size_t threads);
+
+/// Tasks are handed out to the workers round-robin, in submission order
+/// Each worker runs its own tasks in the order they were submitted, so
+/// submitting the most expensive tasks first makes them start first
+t_result pool_submit(struct pool *pool, t_pool_fn *fn, void *arg);
+
+/// Waits for all submitted tasks to finish and stops the workers
+void pool_finish(struct pool *pool);
+
+size_t pool_default_threads(void);
@@ -0,0 +1,338 @@
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "uring.h"
+
+// Not every libc knows these yet, the numbers are the same on (nearly) every architecture
+#ifndef __NR_io_uring_setup
+# define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+# define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+# define __NR_io_uring_register 427
+#endif
+
+struct uring_slot {
+	size_t file;
+	int fd;
+	uint64_t offset;
+	size_t filled;
+	bool active;
+	struct iovec iovec; // only used without registered buffers
+};
+
+struct uring_reader {
+	int ring_fd;
+	unsigned depth;
+
+	void *sq_ring;
+	size_t sq_ring_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	unsigned to_submit;
+
+	void *cq_ring;
+	size_t cq_ring_size;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	uint8_t *buffers;
+	size_t buffer_size;
+	bool fixed_buffers;
+	bool reads_lost; // reads may still write to the buffers, which are leaked rather than freed
+	struct uring_slot *slots;
+};
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *params) {
+	return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+	return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int io_uring_register(int ring_fd, unsigned opcode, void *arg, unsigned nr_args) {
+	return syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+static bool map_rings(struct uring_reader *reader, struct io_uring_params *params) {
+	reader->sq_ring_size = params->sq_off.array + params->sq_entries * sizeof(unsigned);
+	reader->cq_ring_size = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+	if ((params->features & IORING_FEAT_SINGLE_MMAP) != 0) {
+		if (reader->cq_ring_size > reader->sq_ring_size) {
+			reader->sq_ring_size = reader->cq_ring_size;
+		}
+		reader->cq_ring_size = reader->sq_ring_size;
+	}
+
+	reader->sq_ring = mmap(NULL, reader->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, reader->ring_fd, IORING_OFF_SQ_RING);
+	if (reader->sq_ring == MAP_FAILED) {
+		reader->sq_ring = NULL;
+		return false;
+	}
+	if ((params->features & IORING_FEAT_SINGLE_MMAP) != 0) {
+		reader->cq_ring = reader->sq_ring;
+	}
+	else {
+		reader->cq_ring = mmap(NULL, reader->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, reader->ring_fd, IORING_OFF_CQ_RING);
+		if (reader->cq_ring == MAP_FAILED) {
+			reader->cq_ring = NULL;
+			return false;
+		}
+	}
+	reader->sqes_size = params->sq_entries * sizeof(struct io_uring_sqe);
+	reader->sqes = mmap(NULL, reader->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, reader->ring_fd, IORING_OFF_SQES);
+	if (reader->sqes == MAP_FAILED) {
+		reader->sqes = NULL;
+		return false;
+	}
+
+	uint8_t *sq = reader->sq_ring;
+	reader->sq_head = (unsigned *)(sq + params->sq_off.head);
+	reader->sq_tail = (unsigned *)(sq + params->sq_off.tail);
+	reader->sq_mask = (unsigned *)(sq + params->sq_off.ring_mask);
+	reader->sq_array = (unsigned *)(sq + params->sq_off.array);
+
+	uint8_t *cq = reader->cq_ring;
+	reader->cq_head = (unsigned *)(cq + params->cq_off.head);
+	reader->cq_tail = (unsigned *)(cq + params->cq_off.tail);
+	reader->cq_mask = (unsigned *)(cq + params->cq_off.ring_mask);
+	reader->cqes = (struct io_uring_cqe *)(cq + params->cq_off.cqes);
+	return true;
+}
+
+void uring_reader_destroy(struct uring_reader *reader) {
+	if (reader == NULL) {
+		return;
+	}
+	if (reader->sqes != NULL) {
+		munmap(reader->sqes, reader->sqes_size);
+	}
+	if (reader->cq_ring != NULL && reader->cq_ring != reader->sq_ring) {
+		munmap(reader->cq_ring, reader->cq_ring_size);
+	}
+	if (reader->sq_ring != NULL) {
+		munmap(reader->sq_ring, reader->sq_ring_size);
+	}
+	if (reader->ring_fd >= 0) {
+		close(reader->ring_fd);
+	}
+	if (reader->reads_lost) {
+		return;
+	}
+	if (reader->buffers != NULL) {
+		munmap(reader->buffers, (size_t)reader->depth * reader->buffer_size);
+	}
+	free(reader->slots);
+	free(reader);
+}
+
+struct uring_reader *uring_reader_create(unsigned depth, size_t buffer_size) {
+	struct uring_reader *reader = malloc(sizeof(*reader));
+	if (reader == NULL) {
+		return NULL;
+	}
+	*reader = (struct uring_reader){
+		.ring_fd = -1,
+		.depth = depth,
+		.buffer_size = buffer_size,
+		.slots = calloc(depth, sizeof(*reader->slots)),
+	};
+
+	struct io_uring_params params = {0};
+	reader->ring_fd = io_uring_setup(depth, &params);
+	if (reader->slots == NULL || reader->ring_fd < 0 || !map_rings(reader, &params)) {
+		uring_reader_destroy(reader);
+		return NULL;
+	}
+
+	reader->buffers = mmap(NULL, (size_t)depth * buffer_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (reader->buffers == MAP_FAILED) {
+		reader->buffers = NULL;
+		uring_reader_destroy(reader);
+		return NULL;
+	}
+
+	// Registered buffers save the kernel from pinning the pages for every read,
+	// if the memlock limit doesn't allow it the same buffers are used unregistered
+	struct iovec *iovecs = malloc(depth * sizeof(*iovecs));
+	if (iovecs != NULL) {
+		for (unsigned i = 0; i < depth; i++) {
+			iovecs[i] = (struct iovec){
+				.iov_base = reader->buffers + (size_t)i * buffer_size,
+				.iov_len = buffer_size,
+			};
+		}
+		reader->fixed_buffers = io_uring_register(reader->ring_fd, IORING_REGISTER_BUFFERS, iovecs, depth) == 0;
+		free(iovecs);
+	}
+	return reader;
+}
+
+static void submit_read(struct uring_reader *reader, unsigned slot_index) {
+	struct uring_slot *slot = &reader->slots[slot_index];
+	unsigned tail = *reader->sq_tail;
+	unsigned index = tail & *reader->sq_mask;
+	struct io_uring_sqe *sqe = &reader->sqes[index];
+
+	*sqe = (struct io_uring_sqe){
+		.opcode = reader->fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READV,
+		.fd = slot->fd,
+		.off = slot->offset,
+		.user_data = slot_index,
+	};
+	if (reader->fixed_buffers) {
+		sqe->addr = (uintptr_t)(reader->buffers + (size_t)slot_index * reader->buffer_size + slot->filled);
+		sqe->len = reader->buffer_size - slot->filled;
+		sqe->buf_index = slot_index;
+	}
+	else {
+		slot->iovec = (struct iovec){
+			.iov_base = reader->buffers + (size_t)slot_index * reader->buffer_size + slot->filled,
+			.iov_len = reader->buffer_size - slot->filled,
+		};
+		sqe->addr = (uintptr_t)&slot->iovec;
+		sqe->len = 1;
+	}
+
+	reader->sq_array[index] = index;
+	__atomic_store_n(reader->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	reader->to_submit++;
+}
+
+/// Starts reading the next files into the free slots
+static bool fill_slots(struct uring_reader *reader, char const *const *files, size_t file_num, size_t *next_file, unsigned *active, t_uring_error_fn *error_fn, void *ctx) {
+	for (unsigned i = 0; i < reader->depth && *next_file < file_num; i++) {
+		struct uring_slot *slot = &reader->slots[i];
+		while (!slot->active && *next_file < file_num) {
+			size_t file = (*next_file)++;
+			int fd = open(files[file], O_RDONLY);
+			if (fd < 0) {
+				if (!error_fn(ctx, file, errno, true)) {
+					return false;
+				}
+				continue;
+			}
+			*slot = (struct uring_slot){
+				.file = file,
+				.fd = fd,
+				.active = true,
+			};
+			(*active)++;
+			submit_read(reader, i);
+		}
+	}
+	return true;
+}
+
+static void release_slot(struct uring_slot *slot, unsigned *active) {
+	close(slot->fd);
+	slot->active = false;
+	(*active)--;
+}
+
+/// Waits for the reads the kernel was given after `io_uring_enter` failed, their buffers are in use until they complete
+/// The reads still in the submission queue never started, every slot is released
+static void drain_reads(struct uring_reader *reader, unsigned *active) {
+	unsigned in_flight = *active - reader->to_submit;
+	while (in_flight > 0) {
+		if (io_uring_enter(reader->ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+			// They can't be waited for, the ring is closed and the memory they may write to is never reused
+			reader->reads_lost = true;
+			break;
+		}
+		unsigned head = *reader->cq_head;
+		unsigned tail = __atomic_load_n(reader->cq_tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++) {
+			release_slot(&reader->slots[reader->cqes[head & *reader->cq_mask].user_data], active);
+			in_flight--;
+		}
+		__atomic_store_n(reader->cq_head, head, __ATOMIC_RELEASE);
+	}
+	for (unsigned i = 0; i < reader->depth; i++) {
+		if (reader->slots[i].active) {
+			release_slot(&reader->slots[i], active);
+		}
+	}
+}
+
+t_result uring_read_files(struct uring_reader *reader, char const *const *files, size_t file_num, t_uring_data_fn *data_fn, t_uring_error_fn *error_fn, void *ctx) {
+	size_t next_file = 0;
+	unsigned active = 0;
+	bool stopping = !fill_slots(reader, files, file_num, &next_file, &active, error_fn, ctx);
+
+	while (active > 0) {
+		int entered = io_uring_enter(reader->ring_fd, reader->to_submit, 1, IORING_ENTER_GETEVENTS);
+		if (entered < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			int err = errno;
+			drain_reads(reader, &active);
+			errno = err;
+			return set_error(E_ERRNO, "");
+		}
+		reader->to_submit -= entered;
+
+		unsigned head = *reader->cq_head;
+		unsigned tail = __atomic_load_n(reader->cq_tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++) {
+			struct io_uring_cqe *cqe = &reader->cqes[head & *reader->cq_mask];
+			unsigned slot_index = cqe->user_data;
+			struct uring_slot *slot = &reader->slots[slot_index];
+			uint8_t const *buffer = reader->buffers + (size_t)slot_index * reader->buffer_size;
+
+			if (stopping) {
+				release_slot(slot, &active);
+			}
+			else if (cqe->res == -EINTR || cqe->res == -EAGAIN) {
+				submit_read(reader, slot_index);
+			}
+			else if (cqe->res < 0) {
+				stopping = !error_fn(ctx, slot->file, -cqe->res, false);
+				release_slot(slot, &active);
+			}
+			else if (cqe->res == 0) {
+				stopping = !data_fn(ctx, slot->file, buffer, slot->filled, true);
+				release_slot(slot, &active);
+			}
+			else {
+				slot->filled += cqe->res;
+				slot->offset += cqe->res;
+				if (slot->filled == reader->buffer_size) {
+					stopping = !data_fn(ctx, slot->file, buffer, slot->filled, false);
+					slot->filled = 0;
+				}
+				if (stopping) {
+					release_slot(slot, &active);
+				}
+				else {
+					submit_read(reader, slot_index);
+				}
+			}
+		}
+		__atomic_store_n(reader->cq_head, head, __ATOMIC_RELEASE);
+
+		if (!stopping) {
+			stopping = !fill_slots(reader, files, file_num, &next_file, &active, error_fn, ctx);
+		}
+	}
+	if (stopping) {
+		return propagate_error();
+	}
+	return OK;
+}
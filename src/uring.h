@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "error.h"
+
+/// `data` is a full buffer (a multiple of the buffer size passed to `uring_reader_create`),
+/// unless `eof` is set, in which case it is the rest of the file
+/// Returning false stops reading all files, the callback should have set the error
+typedef bool (t_uring_data_fn)(void *ctx, size_t file, uint8_t const *data, size_t len, bool eof);
+
+/// `opening` tells whether the file could not be opened, or could not be read
+/// Returning false stops reading all files, the callback should have set the error
+typedef bool (t_uring_error_fn)(void *ctx, size_t file, int err, bool opening);
+
+struct uring_reader;
+
+/// Returns NULL when io_uring can't be used (old kernel, seccomp, ...), callers should fall back to read()
+/// `depth` files are read at the same time, each into one of `depth` buffers of `buffer_size` bytes
+struct uring_reader *uring_reader_create(unsigned depth, size_t buffer_size);
+
+/// Reads every file from start to end, calling `data_fn` for each filled buffer
+/// Files can be interleaved, but the data of one file is always passed in order
+t_result uring_read_files(struct uring_reader *reader, char const *const *files, size_t file_num, t_uring_data_fn *data_fn, t_uring_error_fn *error_fn, void *ctx);
+
+void uring_reader_destroy(struct uring_reader *reader);
@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <unistd.h>
 
+#include "output.h"
 #include "utils.h"
 
 void ft_memcpy(void *dst, void const *src, size_t bytes) {
@@ -28,33 +29,47 @@ size_t ft_strlen_max(char const *str, size_t max) {
 }
 
 void ft_putstr(int fd, char const *s) {
-	write(fd, s, ft_strlen(s));
+	output_write(fd, s, ft_strlen(s));
 }
 
-void ft_putstrs(int fd, char const * const *strs) {
-	char buffer[1024];
-	size_t buffer_index = 0;
-	while (*strs != NULL) {
-		size_t len = ft_strlen(*strs);
-		if (buffer_index + len <= sizeof(buffer)) {
-			ft_memcpy(buffer + buffer_index, *strs, len);
-			buffer_index += len;
+/// Keeps reading until `buffer` is full or the end of the file is reached
+ssize_t ft_read_full(int fd, void *buffer, size_t size) {
+	uint8_t *bytes = buffer;
+	size_t filled = 0;
+	while (filled < size) {
+		ssize_t nread = read(fd, bytes + filled, size - filled);
+		if (nread < 0) {
+			return nread;
 		}
-		else {
-			write(fd, buffer, buffer_index);
-			buffer_index = 0;
-			if (len <= sizeof(buffer)) {
-				ft_memcpy(buffer + buffer_index, *strs, len);
-				buffer_index += len;
-			}
-			else {
-				write(fd, *strs, ft_strlen(*strs));
-			}
+		if (nread == 0) {
+			break;
 		}
-		strs++;
+		filled += nread;
 	}
-	if (buffer_index > 0) {
-		write(fd, buffer, buffer_index);
+	return filled;
+}
+
+/// Same as `ft_read_full`, from `offset` in the file instead of the file position
+ssize_t ft_pread_full(int fd, void *buffer, size_t size, off_t offset) {
+	uint8_t *bytes = buffer;
+	size_t filled = 0;
+	while (filled < size) {
+		ssize_t nread = pread(fd, bytes + filled, size - filled, offset + filled);
+		if (nread < 0) {
+			return nread;
+		}
+		if (nread == 0) {
+			break;
+		}
+		filled += nread;
+	}
+	return filled;
+}
+
+void ft_putstrs(int fd, char const * const *strs) {
+	while (*strs != NULL) {
+		output_write(fd, *strs, ft_strlen(*strs));
+		strs++;
 	}
 }
 
@@ -66,6 +81,53 @@ bool ft_streq(char const *a, char const *b) {
 	return a[i] == b[i];
 }
 
+/// Parses a decimal number, returns false when `str` isn't a (representable) number
+bool ft_parse_size(char const *str, size_t *n) {
+	*n = 0;
+	if (str[0] == '\0') {
+		return false;
+	}
+	for (size_t i = 0; str[i] != '\0'; i++) {
+		if (str[i] < '0' || str[i] > '9' || *n > (SIZE_MAX - (str[i] - '0')) / 10) {
+			return false;
+		}
+		*n = *n * 10 + (str[i] - '0');
+	}
+	return true;
+}
+
+/// Same as `ft_parse_size`, with an optional K, M or G suffix (powers of 1024)
+bool ft_parse_bytes(char const *str, size_t *n) {
+	size_t len = ft_strlen(str);
+	uint8_t shift = 0;
+	if (len > 0 && (str[len - 1] == 'K' || str[len - 1] == 'M' || str[len - 1] == 'G')) {
+		shift = str[len - 1] == 'K' ? 10 : str[len - 1] == 'M' ? 20 : 30;
+		len--;
+	}
+	char digits[32];
+	if (len >= sizeof(digits)) {
+		return false;
+	}
+	ft_memcpy(digits, str, len);
+	digits[len] = '\0';
+	if (!ft_parse_size(digits, n) || *n > SIZE_MAX >> shift) {
+		return false;
+	}
+	*n <<= shift;
+	return true;
+}
+
+/// Writes `n` in decimal to `buffer`, returns the start of the number inside it
+char const *ft_utoa(uint64_t n, char buffer[21]) {
+	size_t i = 20;
+	buffer[i] = '\0';
+	do {
+		buffer[--i] = '0' + n % 10;
+		n /= 10;
+	} while (n > 0);
+	return &buffer[i];
+}
+
 uint32_t right_rotate(uint32_t num, uint8_t rotate_amount) {
 	return (num >> rotate_amount) | (num << (32 - rotate_amount));
 }
@@ -141,7 +203,7 @@ static void print_escaped_block(int fd, uint8_t const *buffer, size_t len) {
 			buffer_index++;
 		}
 	}
-	write(fd, escaped, escaped_index);
+	output_write(fd, escaped, escaped_index);
 }
 
 void print_escaped(int fd, uint8_t const *buffer, size_t len) {
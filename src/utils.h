@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/types.h>
 
 #ifndef PROGRAM
 # define PROGRAM "ft_ssl"
@@ -12,8 +13,13 @@ void ft_memcpy(void *dst, void const *src, size_t bytes);
 size_t ft_strlen(char const *s);
 size_t ft_strlen_max(char const *str, size_t max);
 void ft_putstr(int fd, char const *s);
+ssize_t ft_read_full(int fd, void *buffer, size_t size);
+ssize_t ft_pread_full(int fd, void *buffer, size_t size, off_t offset);
 void ft_putstrs(int fd, char const * const *strs);
 bool ft_streq(char const *a, char const *b);
+bool ft_parse_size(char const *str, size_t *n);
+bool ft_parse_bytes(char const *str, size_t *n);
+char const *ft_utoa(uint64_t n, char buffer[21]);
 uint32_t left_rotate(uint32_t num, uint8_t rotate_amount);
 uint32_t right_rotate(uint32_t num, uint8_t rotate_amount);
 void print_escaped(int fd, uint8_t const *buffer, size_t len);
@@ -0,0 +1,502 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "utils.h"
+#include "walk.h"
+
+/// Amount of bytes of directory entries read per syscall
+#ifndef WALK_DENTS_BYTES
+# define WALK_DENTS_BYTES (64 * 1024)
+#endif
+
+/// Amount of directories the threads can have read before `walk_next` gets to them
+/// Past it the threads wait, and `walk_next` reads the directories it needs itself
+#ifndef WALK_READ_AHEAD_DIRS
+# define WALK_READ_AHEAD_DIRS 4096
+#endif
+
+/// A record returned by getdents64
+struct linux_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+enum e_dir_state {
+	DIR_QUEUED,
+	DIR_READING,
+	DIR_READ,
+};
+
+struct walk_entry {
+	char const *name;
+	size_t name_offset; // in the names of the directory, `name` is only set once they are all read
+	bool is_dir;
+	struct walk_dir *dir; // once the directory is read, NULL for files
+};
+
+struct walk_dir {
+	struct walk_dir *parent;
+	char *path;
+	enum e_dir_state state;
+	bool in_stack;
+	bool dropped; // released while still in the stack, it is freed when popped
+	bool read_ahead; // read by a thread, it counts towards `WALK_READ_AHEAD_DIRS` until released
+	bool acquired; // only used by `walk_next`
+	bool reported;
+	int err;
+	dev_t dev;
+	ino_t ino;
+
+	char *names;
+	size_t names_len;
+	size_t names_cap;
+	struct walk_entry *entries;
+	size_t entry_num;
+	size_t entry_cap;
+	size_t next; // first entry `walk_next` didn't get to
+};
+
+struct walk {
+	struct walk_options opts;
+	char const *const *roots;
+	size_t root_num;
+	size_t next_root;
+	struct walk_dir *current;
+	char *path;
+	size_t path_cap;
+	uint8_t *buffer;
+
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t read;
+	bool stopping;
+	size_t read_ahead;
+	// Directories waiting to be read, the next one `walk_next` needs is usually on top
+	struct walk_dir **stack;
+	size_t stack_len;
+	size_t stack_cap;
+
+	pthread_t *threads;
+	size_t thread_num;
+};
+
+/// Makes room for `need` elements of `size` bytes in `*array`
+static bool grow(void **array, size_t *cap, size_t need, size_t size) {
+	if (need <= *cap) {
+		return true;
+	}
+	size_t new_cap = *cap == 0 ? 64 : *cap;
+	while (new_cap < need) {
+		new_cap *= 2;
+	}
+	void *grown = realloc(*array, new_cap * size);
+	if (grown == NULL) {
+		return false;
+	}
+	*array = grown;
+	*cap = new_cap;
+	return true;
+}
+
+/// Sets `*path` to `dir/name`
+static bool join_path(char **path, size_t *cap, char const *dir, char const *name) {
+	size_t dir_len = ft_strlen(dir);
+	size_t name_len = ft_strlen(name);
+	bool slash = dir_len > 0 && dir[dir_len - 1] != '/';
+	if (!grow((void **)path, cap, dir_len + slash + name_len + 1, 1)) {
+		return false;
+	}
+	ft_memcpy(*path, dir, dir_len);
+	(*path)[dir_len] = '/';
+	ft_memcpy(*path + dir_len + slash, name, name_len + 1);
+	return true;
+}
+
+static struct walk_dir *new_dir(struct walk_dir *parent, char const *path) {
+	struct walk_dir *dir = malloc(sizeof(*dir));
+	if (dir == NULL) {
+		return NULL;
+	}
+	*dir = (struct walk_dir){
+		.parent = parent,
+		.state = DIR_QUEUED,
+	};
+	size_t cap = 0;
+	if (parent == NULL) {
+		size_t len = ft_strlen(path);
+		while (len > 1 && path[len - 1] == '/') {
+			len--;
+		}
+		if (grow((void **)&dir->path, &cap, len + 1, 1)) {
+			ft_memcpy(dir->path, path, len);
+			dir->path[len] = '\0';
+		}
+	}
+	else if (!join_path(&dir->path, &cap, parent->path, path)) {
+		dir->path = NULL;
+	}
+	if (dir->path == NULL) {
+		free(dir);
+		return NULL;
+	}
+	return dir;
+}
+
+/// Frees the directory, but not the directories in it
+static void free_dir(struct walk_dir *dir) {
+	free(dir->entries);
+	free(dir->names);
+	free(dir->path);
+	free(dir);
+}
+
+/// Forgets the entries of a directory whose children were never queued
+static void free_listing(struct walk_dir *dir) {
+	for (size_t i = 0; i < dir->entry_num; i++) {
+		if (dir->entries[i].dir != NULL) {
+			free_dir(dir->entries[i].dir);
+		}
+	}
+	free(dir->entries);
+	free(dir->names);
+	dir->entries = NULL;
+	dir->names = NULL;
+	dir->entry_num = 0;
+}
+
+/// DT_REG or DT_DIR for the entries to list, DT_UNKNOWN for those to skip
+static unsigned char entry_type(int fd, struct linux_dirent64 const *dirent, bool follow_links) {
+	unsigned char type = dirent->d_type;
+	if (type == DT_UNKNOWN || (type == DT_LNK && follow_links)) {
+		struct stat st;
+		if (fstatat(fd, dirent->d_name, &st, follow_links ? 0 : AT_SYMLINK_NOFOLLOW) != 0) {
+			// Listed anyway so opening it reports why, unless it is a dangling link
+			return type == DT_LNK ? DT_UNKNOWN : DT_REG;
+		}
+		type = S_ISREG(st.st_mode) ? DT_REG : S_ISDIR(st.st_mode) ? DT_DIR : DT_UNKNOWN;
+	}
+	return type == DT_REG || type == DT_DIR ? type : DT_UNKNOWN;
+}
+
+static int compare_entry_name(void const *a, void const *b) {
+	return strcmp(((struct walk_entry const *)a)->name, ((struct walk_entry const *)b)->name);
+}
+
+/// Reads the entries of the directory behind `fd` sorted by name, and creates their directories
+/// Returns 0 on success, or the errno value of the failure
+static int list_dir(struct walk *walk, struct walk_dir *dir, int fd, uint8_t *buffer) {
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		return errno;
+	}
+	dir->dev = st.st_dev;
+	dir->ino = st.st_ino;
+	if (dir->parent != NULL && walk->opts.one_filesystem && st.st_dev != dir->parent->dev) {
+		return 0;
+	}
+	// Without following links a directory can't contain itself
+	for (struct walk_dir *parent = dir->parent; walk->opts.follow_links && parent != NULL; parent = parent->parent) {
+		if (parent->dev == st.st_dev && parent->ino == st.st_ino) {
+			return ELOOP;
+		}
+	}
+
+	while (true) {
+		long len = syscall(SYS_getdents64, fd, buffer, WALK_DENTS_BYTES);
+		if (len < 0) {
+			return errno;
+		}
+		if (len == 0) {
+			break;
+		}
+		for (long offset = 0; offset < len; offset += ((struct linux_dirent64 *)(buffer + offset))->d_reclen) {
+			struct linux_dirent64 const *dirent = (struct linux_dirent64 *)(buffer + offset);
+			if (ft_streq(dirent->d_name, ".") || ft_streq(dirent->d_name, "..")) {
+				continue;
+			}
+			unsigned char type = entry_type(fd, dirent, walk->opts.follow_links);
+			if (type == DT_UNKNOWN) {
+				continue;
+			}
+			size_t name_len = ft_strlen(dirent->d_name);
+			if (
+				!grow((void **)&dir->names, &dir->names_cap, dir->names_len + name_len + 1, 1) ||
+				!grow((void **)&dir->entries, &dir->entry_cap, dir->entry_num + 1, sizeof(*dir->entries))
+			) {
+				return ENOMEM;
+			}
+			ft_memcpy(dir->names + dir->names_len, dirent->d_name, name_len + 1);
+			dir->entries[dir->entry_num++] = (struct walk_entry){
+				.name_offset = dir->names_len,
+				.is_dir = type == DT_DIR,
+			};
+			dir->names_len += name_len + 1;
+		}
+	}
+
+	for (size_t i = 0; i < dir->entry_num; i++) {
+		dir->entries[i].name = dir->names + dir->entries[i].name_offset;
+	}
+	if (dir->entry_num > 1) {
+		qsort(dir->entries, dir->entry_num, sizeof(*dir->entries), &compare_entry_name);
+	}
+	for (size_t i = 0; i < dir->entry_num; i++) {
+		if (dir->entries[i].is_dir && (dir->entries[i].dir = new_dir(dir, dir->entries[i].name)) == NULL) {
+			return ENOMEM;
+		}
+	}
+	return 0;
+}
+
+/// Lists the directory, without the lock, failures are kept in `dir->err`
+static void read_dir(struct walk *walk, struct walk_dir *dir, uint8_t *buffer) {
+	int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+	if (dir->parent != NULL && !walk->opts.follow_links) {
+		flags |= O_NOFOLLOW;
+	}
+	int fd = open(dir->path, flags);
+	int err = fd < 0 ? errno : list_dir(walk, dir, fd, buffer);
+	if (fd >= 0) {
+		close(fd);
+	}
+	if (err != 0) {
+		free_listing(dir);
+		dir->err = err;
+	}
+}
+
+/// Queues the directories of the read `dir`, the first one on top, with the lock held
+/// Those that don't fit are read by `walk_next` when it gets to them
+static void publish_dir(struct walk *walk, struct walk_dir *dir) {
+	size_t dir_num = 0;
+	for (size_t i = 0; i < dir->entry_num; i++) {
+		dir_num += dir->entries[i].dir != NULL;
+	}
+	if (dir_num > 0 && grow((void **)&walk->stack, &walk->stack_cap, walk->stack_len + dir_num, sizeof(*walk->stack))) {
+		for (size_t i = dir->entry_num; i > 0; i--) {
+			struct walk_dir *child = dir->entries[i - 1].dir;
+			if (child != NULL) {
+				child->in_stack = true;
+				walk->stack[walk->stack_len++] = child;
+			}
+		}
+		pthread_cond_broadcast(&walk->work);
+	}
+	dir->state = DIR_READ;
+	pthread_cond_broadcast(&walk->read);
+}
+
+/// Frees the directory, or leaves that to whoever pops it from the stack, with the lock held
+static void discard_dir(struct walk_dir *dir) {
+	if (dir->in_stack) {
+		dir->dropped = true;
+	}
+	else {
+		free_dir(dir);
+	}
+}
+
+static void *walk_thread(void *arg) {
+	struct walk *walk = arg;
+	uint8_t *buffer = malloc(WALK_DENTS_BYTES);
+
+	pthread_mutex_lock(&walk->lock);
+	while (buffer != NULL) {
+		while (!walk->stopping && (walk->stack_len == 0 || walk->read_ahead >= WALK_READ_AHEAD_DIRS)) {
+			pthread_cond_wait(&walk->work, &walk->lock);
+		}
+		if (walk->stopping) {
+			break;
+		}
+		struct walk_dir *dir = walk->stack[--walk->stack_len];
+		dir->in_stack = false;
+		if (dir->dropped) {
+			free_dir(dir);
+			continue;
+		}
+		if (dir->state != DIR_QUEUED) {
+			continue;
+		}
+		dir->state = DIR_READING;
+		dir->read_ahead = true;
+		walk->read_ahead++;
+		pthread_mutex_unlock(&walk->lock);
+
+		read_dir(walk, dir, buffer);
+
+		pthread_mutex_lock(&walk->lock);
+		publish_dir(walk, dir);
+	}
+	pthread_mutex_unlock(&walk->lock);
+	free(buffer);
+	return NULL;
+}
+
+/// Waits for the directory to be read, or reads it when no thread started to
+static void acquire_dir(struct walk *walk, struct walk_dir *dir) {
+	pthread_mutex_lock(&walk->lock);
+	if (dir->state == DIR_QUEUED) {
+		dir->state = DIR_READING;
+		pthread_mutex_unlock(&walk->lock);
+		read_dir(walk, dir, walk->buffer);
+		pthread_mutex_lock(&walk->lock);
+		publish_dir(walk, dir);
+	}
+	while (dir->state != DIR_READ) {
+		pthread_cond_wait(&walk->read, &walk->lock);
+	}
+	pthread_mutex_unlock(&walk->lock);
+	dir->acquired = true;
+}
+
+static void release_dir(struct walk *walk, struct walk_dir *dir) {
+	pthread_mutex_lock(&walk->lock);
+	if (dir->read_ahead) {
+		walk->read_ahead--;
+		pthread_cond_signal(&walk->work);
+	}
+	discard_dir(dir);
+	pthread_mutex_unlock(&walk->lock);
+}
+
+static void stop_threads(struct walk *walk, size_t started) {
+	pthread_mutex_lock(&walk->lock);
+	walk->stopping = true;
+	pthread_cond_broadcast(&walk->work);
+	pthread_mutex_unlock(&walk->lock);
+	for (size_t i = 0; i < started; i++) {
+		pthread_join(walk->threads[i], NULL);
+	}
+}
+
+static void free_walk(struct walk *walk) {
+	pthread_cond_destroy(&walk->read);
+	pthread_cond_destroy(&walk->work);
+	pthread_mutex_destroy(&walk->lock);
+	free(walk->stack);
+	free(walk->threads);
+	free(walk->buffer);
+	free(walk->path);
+	free(walk);
+}
+
+t_result walk_start(struct walk **walk_ptr, char const *const *roots, size_t root_num, struct walk_options const *opts) {
+	struct walk *walk = malloc(sizeof(*walk));
+	if (walk == NULL) {
+		return set_error(E_ERRNO, "");
+	}
+	*walk = (struct walk){
+		.opts = *opts,
+		.roots = roots,
+		.root_num = root_num,
+		.buffer = malloc(WALK_DENTS_BYTES),
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.work = PTHREAD_COND_INITIALIZER,
+		.read = PTHREAD_COND_INITIALIZER,
+		.threads = calloc(opts->threads, sizeof(*walk->threads)),
+	};
+	if (walk->buffer == NULL || (opts->threads > 0 && walk->threads == NULL)) {
+		free_walk(walk);
+		return set_error(E_ERRNO, "");
+	}
+
+	for (size_t i = 0; i < opts->threads; i++) {
+		int err = pthread_create(&walk->threads[i], NULL, &walk_thread, walk);
+		if (err != 0) {
+			stop_threads(walk, i);
+			free_walk(walk);
+			errno = err;
+			return set_error(E_ERRNO, "");
+		}
+	}
+	walk->thread_num = opts->threads;
+
+	*walk_ptr = walk;
+	return OK;
+}
+
+int walk_next(struct walk *walk, char const **path, int *err) {
+	*err = 0;
+	while (true) {
+		struct walk_dir *dir = walk->current;
+		if (dir == NULL) {
+			if (walk->next_root == walk->root_num) {
+				return 0;
+			}
+			char const *root = walk->roots[walk->next_root++];
+			struct stat st;
+			if (stat(root, &st) != 0 || !S_ISDIR(st.st_mode)) {
+				*path = root;
+				return 1;
+			}
+			if ((dir = new_dir(NULL, root)) == NULL) {
+				return -1;
+			}
+			walk->current = dir;
+		}
+
+		if (!dir->acquired) {
+			acquire_dir(walk, dir);
+		}
+		if (dir->err != 0 && !dir->reported) {
+			dir->reported = true;
+			*path = dir->path;
+			*err = dir->err;
+			return 1;
+		}
+		if (dir->next < dir->entry_num) {
+			struct walk_entry const *entry = &dir->entries[dir->next++];
+			if (entry->dir != NULL) {
+				walk->current = entry->dir;
+				continue;
+			}
+			if (!join_path(&walk->path, &walk->path_cap, dir->path, entry->name)) {
+				return -1;
+			}
+			*path = walk->path;
+			return 1;
+		}
+		walk->current = dir->parent;
+		release_dir(walk, dir);
+	}
+}
+
+/// Discards the directories in `dir` that `walk_next` didn't get to, with the threads stopped
+static void discard_unvisited(struct walk_dir *dir) {
+	for (size_t i = dir->next; i < dir->entry_num; i++) {
+		struct walk_dir *child = dir->entries[i].dir;
+		if (child != NULL) {
+			discard_unvisited(child);
+			discard_dir(child);
+		}
+	}
+}
+
+void walk_finish(struct walk *walk) {
+	stop_threads(walk, walk->thread_num);
+
+	// Everything left is either on the current path, under the entries it didn't get to, or dropped in the stack
+	for (struct walk_dir *dir = walk->current; dir != NULL;) {
+		struct walk_dir *parent = dir->parent;
+		discard_unvisited(dir);
+		discard_dir(dir);
+		dir = parent;
+	}
+	for (size_t i = 0; i < walk->stack_len; i++) {
+		if (walk->stack[i]->dropped) {
+			free_dir(walk->stack[i]);
+		}
+	}
+	free_walk(walk);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "error.h"
+
+struct walk_options {
+	bool follow_links; // symlinks found in the trees are followed, otherwise they are skipped
+	bool one_filesystem; // directories on another filesystem than their parent are not entered
+	size_t threads; // amount of threads reading directories ahead of `walk_next`
+};
+
+struct walk;
+
+/// Starts listing the regular files under `roots`, which must stay valid until `walk_finish`
+/// Roots are followed even when they are symlinks, those that aren't directories are listed as they are
+t_result walk_start(struct walk **walk, char const *const *roots, size_t root_num, struct walk_options const *opts);
+
+/// Sets `path` to the next file, valid until the next call, returns 0 when all were listed and -1 on failure (errno)
+/// Roots come in the given order, and the entries of each directory sorted by name, depth first
+/// `err` is set when `path` is a directory that couldn't be read, it has no entries but should be reported
+int walk_next(struct walk *walk, char const **path, int *err);
+
+/// Stops the threads, `walk_next` doesn't have to have listed everything
+void walk_finish(struct walk *walk);
@@ -0,0 +1,86 @@
+# -cache: hits return the stored hash, changed files are hashed again, damaged cache files are started over
+NAME=cache
+. "$(dirname "$0")/lib.sh"
+
+# Files modified in the last seconds are never stored, these are older
+make_files files 40
+touch -d '1 hour ago' files/*
+set -- files/*
+
+# expect_hit DESCRIPTION FILE: the hash printed for FILE comes from the cache, its contents are not read
+# A rewrite that keeps the size and the modification time can't be seen, only a stored hash gives the old one
+expect_hit() {
+	grep "($2)" expected > stale
+	cp -p "$2" saved
+	head -c "$(wc -c < "$2")" /dev/zero > "$2"
+	touch -r saved "$2"
+	"$FT_SSL" md5 -cache cache "$2" > out 2>&1
+	expect_same "$1" out stale
+	cp -p saved "$2"
+}
+
+"$FT_SSL" md5 "$@" > expected 2>&1
+"$FT_SSL" md5 -cache cache "$@" > out 2>&1
+expect_status "first run" 0 $?
+expect_same "first run" out expected
+"$FT_SSL" md5 -cache cache "$@" > out 2>&1
+expect_same "second run" out expected
+"$FT_SSL" md5 -cache cache -j 4 "$@" > out 2>&1
+expect_same "second run with -j 4" out expected
+
+expect_hit "hit" files/f3
+
+# Anything else that changes is hashed again
+head -c "$(wc -c < files/f3)" /dev/zero > files/f3
+touch -r saved files/f3
+touch -d '30 minutes ago' files/f3
+head -c "$(wc -c < files/f4)" /dev/zero > files/f4
+touch -d '30 minutes ago' files/f4
+cp files/f5 copy
+echo more >> copy
+touch -r files/f5 copy
+mv copy files/f5
+cp files/f6 copy
+touch -r files/f6 copy
+mv copy files/f6
+"$FT_SSL" md5 "$@" > expected 2>&1
+"$FT_SSL" md5 -cache cache "$@" > out 2>&1
+expect_same "touched, rewritten, grown and moved files" out expected
+
+# Damaged cache files are replaced by empty ones
+head -c 100 cache > cut
+mv cut cache
+"$FT_SSL" md5 -cache cache "$@" > out 2>&1
+expect_status "truncated cache" 0 $?
+expect_same "truncated cache" out expected
+"$FT_SSL" md5 -cache cache "$@" > out 2>&1
+expect_same "rebuilt cache" out expected
+expect_hit "hit in the rebuilt cache" files/f7
+
+head -c $(($(wc -c < cache) - 1000)) cache > cut
+mv cut cache
+"$FT_SSL" md5 -cache cache "$@" > out 2>&1
+expect_same "cache cut in the records" out expected
+
+# The records start after a 64-byte header and an index of 4096 slots of 8 bytes
+head -c 2000 /dev/urandom | dd of=cache bs=1 seek=32832 conv=notrunc 2> /dev/null
+"$FT_SSL" md5 -cache cache "$@" > out 2>&1
+expect_same "corrupted records" out expected
+head -c 4000 /dev/urandom | dd of=cache bs=1 seek=64 conv=notrunc 2> /dev/null
+"$FT_SSL" md5 -cache cache "$@" > out 2>&1
+expect_same "corrupted index" out expected
+printf '\377\377' | dd of=cache bs=1 seek=8 conv=notrunc 2> /dev/null
+"$FT_SSL" md5 -cache cache "$@" > out 2>&1
+expect_status "corrupted header" 0 $?
+expect_same "corrupted header" out expected
+
+# Other files are not overwritten
+echo "not a cache" > other
+cp other other.orig
+"$FT_SSL" md5 -cache other files/f1 > out 2>&1
+expect_status "not a cache file" 1 $?
+echo "ft_ssl: Error: md5: other: Not a digest cache file" > expected
+expect_same "not a cache file" out expected
+expect_same "not a cache file is left alone" other other.orig
+
+finish
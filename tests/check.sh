@@ -0,0 +1,111 @@
+# -c with both manifest formats: OK, FAILED, unreadable and malformed lines, and the exit status of each
+NAME=check
+. "$(dirname "$0")/lib.sh"
+
+echo hello > a
+echo world > b
+mkdir dir
+"$FT_SSL" md5 a b > tagged
+"$FT_SSL" md5 -r a b > reversed
+
+# check DESCRIPTION EXPECTED_STATUS ARGS... < EXPECTED_OUTPUT: stdout and stderr together
+check() {
+	desc=$1
+	status=$2
+	shift 2
+	cat > expected
+	"$FT_SSL" "$@" > out 2>&1
+	expect_status "$desc" "$status" $?
+	expect_same "$desc" out expected
+}
+
+check "all OK" 0 md5 -c tagged <<EOF
+a: OK
+b: OK
+2 files: 2 OK, 0 FAILED, 0 unreadable
+EOF
+
+check "all OK, -r format" 0 md5 -c reversed <<EOF
+a: OK
+b: OK
+2 files: 2 OK, 0 FAILED, 0 unreadable
+EOF
+
+"$FT_SSL" md5 b | "$FT_SSL" md5 -c - > out 2>&1
+expect_status "manifest from stdin" 0 $?
+printf 'b: OK\n1 file: 1 OK, 0 FAILED, 0 unreadable\n' > expected
+expect_same "manifest from stdin" out expected
+
+echo changed >> a
+check "FAILED" 1 md5 -c tagged <<EOF
+a: FAILED
+b: OK
+2 files: 1 OK, 1 FAILED, 0 unreadable
+ft_ssl: Error: md5: tagged: Verification failed
+EOF
+
+check "-q only prints failures" 1 md5 -q -c reversed <<EOF
+a: FAILED
+2 files: 1 OK, 1 FAILED, 0 unreadable
+ft_ssl: Error: md5: reversed: Verification failed
+EOF
+
+{ echo "591785b794601e212b260e25925636fd missing"; echo "591785b794601e212b260e25925636fd dir"; } > unreadable
+check "unreadable" 1 md5 -c unreadable <<EOF
+ft_ssl: Error: md5: missing: No such file or directory
+missing: FAILED open or read
+ft_ssl: Error: md5: dir: Is a directory
+dir: FAILED open or read
+2 files: 0 OK, 0 FAILED, 2 unreadable
+ft_ssl: Error: md5: unreadable: Verification failed
+EOF
+
+{ echo "591785b794601e212b260e25925636fd b"; echo "garbage"; echo "MD5(b)= 0123"; echo "591785b794601e212b260e25925636fd"; } > malformed
+check "malformed lines" 1 md5 -c malformed <<EOF
+ft_ssl: Error: md5: malformed: Line 2 is improperly formatted
+ft_ssl: Error: md5: malformed: Line 3 is improperly formatted
+ft_ssl: Error: md5: malformed: Line 4 is improperly formatted
+b: OK
+1 file: 1 OK, 0 FAILED, 0 unreadable, 3 malformed lines
+ft_ssl: Error: md5: malformed: Verification failed
+EOF
+
+check "manifest of another digest" 1 sha256 -c tagged <<EOF
+ft_ssl: Error: sha256: tagged: Line 1 is improperly formatted
+ft_ssl: Error: sha256: tagged: Line 2 is improperly formatted
+0 files: 0 OK, 0 FAILED, 0 unreadable, 2 malformed lines
+ft_ssl: Error: sha256: tagged: Verification failed
+EOF
+
+"$FT_SSL" md5 -tree 1K a b > tree
+check "tree hashes" 0 md5 -tree 1K -c tree <<EOF
+a: OK
+b: OK
+2 files: 2 OK, 0 FAILED, 0 unreadable
+EOF
+
+check "tree hashes without -tree" 1 md5 -q -c tree <<EOF
+ft_ssl: Error: md5: tree: Line 1 is improperly formatted
+ft_ssl: Error: md5: tree: Line 2 is improperly formatted
+0 files: 0 OK, 0 FAILED, 0 unreadable, 2 malformed lines
+ft_ssl: Error: md5: tree: Verification failed
+EOF
+
+check "missing manifest" 1 md5 -c nothing <<EOF
+ft_ssl: Error: md5: nothing: No such file or directory
+EOF
+
+# More files than are hashed in one batch, one of them changed near the end
+make_files many 4200
+"$FT_SSL" sha256 -r many/* > big
+head -c 10 /dev/urandom >> many/f4150
+"$FT_SSL" sha256 -q -c big > out 2>&1
+expect_status "4200 files" 1 $?
+cat > expected <<EOF
+many/f4150: FAILED
+4200 files: 4199 OK, 1 FAILED, 0 unreadable
+ft_ssl: Error: sha256: big: Verification failed
+EOF
+expect_same "4200 files" out expected
+
+finish
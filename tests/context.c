@@ -0,0 +1,122 @@
+// Feeds the same messages to the streaming contexts of context.h split in many ways (1 byte at a time,
+// 63, 64 or 65 bytes at a time, at random points, with empty updates) and checks that every split,
+// a clone of a common prefix and a reset context give the one-shot digest
+
+#include "context.h"
+#include "test.h"
+
+#define MAX_LEN (65536 + 100)
+#define RANDOM_SPLITS 40
+
+/// Update sizes repeated until the message ends, the last one is cut short
+static size_t const split_1[] = { 1 };
+static size_t const split_63[] = { 63 };
+static size_t const split_64[] = { 64 };
+static size_t const split_65[] = { 65 };
+static size_t const split_mixed[] = { 0, 63, 1, 64, 0, 65, 127, 129 };
+
+/// Everything but the update loop is the same for every algorithm
+/// `one_shot` hashes a whole message with the rounds and the final round, without a context
+#define DEFINE_CHECKS(name, hash_type) \
+	static struct hash_type name##_one_shot(uint8_t const *data, size_t len) { \
+		struct name##_state state = name##_state(); \
+		name##_rounds(&state, data, len / 64); \
+		uint8_t block[64] = {0}; \
+		memcpy(block, data + len / 64 * 64, len % 64); \
+		return name##_final_round(state, block, len % 64 * 8); \
+	} \
+	\
+	static struct hash_type name##_split(uint8_t const *data, size_t len, size_t const *sizes, size_t size_num) { \
+		struct name##_ctx ctx; \
+		name##_init(&ctx); \
+		for (size_t done = 0, i = 0; done < len; i++) { \
+			size_t size = sizes[i % size_num] < len - done ? sizes[i % size_num] : len - done; \
+			name##_update(&ctx, data + done, size); \
+			done += size; \
+		} \
+		struct hash_type hash; \
+		name##_final(&ctx, &hash); \
+		return hash; \
+	} \
+	\
+	static void name##_check(uint8_t const *data, size_t len, size_t const *sizes, size_t size_num, char const *desc) { \
+		struct hash_type expected = name##_one_shot(data, len); \
+		struct hash_type hash = name##_split(data, len, sizes, size_num); \
+		CHECK(memcmp(&hash, &expected, sizeof(hash)) == 0, #name ": %zu bytes split %s differ from one shot", len, desc); \
+	} \
+	\
+	/* `a` and `a` with its end from `b` after `prefix` bytes, hashed from one context cloned after the prefix */ \
+	static void name##_check_clone(uint8_t const *a, uint8_t const *b, uint8_t *both, size_t prefix, size_t len) { \
+		struct name##_ctx ctx_a; \
+		struct name##_ctx ctx_b; \
+		name##_init(&ctx_a); \
+		name##_update(&ctx_a, a, prefix); \
+		name##_clone(&ctx_b, &ctx_a); \
+		name##_update(&ctx_a, a + prefix, len - prefix); \
+		name##_update(&ctx_b, b + prefix, len - prefix); \
+		struct hash_type hash_a; \
+		struct hash_type hash_b; \
+		name##_final(&ctx_a, &hash_a); \
+		name##_final(&ctx_b, &hash_b); \
+		struct hash_type expected_a = name##_one_shot(a, len); \
+		memcpy(both, a, prefix); \
+		memcpy(both + prefix, b + prefix, len - prefix); \
+		struct hash_type expected_b = name##_one_shot(both, len); \
+		CHECK(memcmp(&hash_a, &expected_a, sizeof(hash_a)) == 0, #name ": original differs after a clone at %zu of %zu", prefix, len); \
+		CHECK(memcmp(&hash_b, &expected_b, sizeof(hash_b)) == 0, #name ": clone at %zu of %zu differs", prefix, len); \
+		\
+		name##_reset(&ctx_a); \
+		name##_update(&ctx_a, both, len); \
+		name##_final(&ctx_a, &hash_a); \
+		CHECK(memcmp(&hash_a, &expected_b, sizeof(hash_a)) == 0, #name ": reset context differs on %zu bytes", len); \
+	} \
+	\
+	static void name##_check_all(uint8_t const *data, uint8_t const *other, uint8_t *both, char const *abc_hex) { \
+		struct hash_type abc; \
+		struct name##_ctx ctx; \
+		name##_init(&ctx); \
+		name##_update(&ctx, "a", 1); \
+		name##_update(&ctx, "", 0); \
+		name##_update(&ctx, "bc", 2); \
+		name##_final(&ctx, &abc); \
+		CHECK(strcmp(hash_type##_hex(&abc).hex, abc_hex) == 0, #name ": \"abc\" gives %s", hash_type##_hex(&abc).hex); \
+		\
+		size_t const edge_num = sizeof(test_edge_lengths) / sizeof(*test_edge_lengths); \
+		uint64_t seed = 0x636f6e74657874; \
+		for (size_t i = 0; i < edge_num + 40; i++) { \
+			size_t len = i < edge_num ? test_edge_lengths[i] : test_random(&seed) % MAX_LEN; \
+			size_t random_sizes[RANDOM_SPLITS]; \
+			for (size_t j = 0; j < RANDOM_SPLITS; j++) { \
+				random_sizes[j] = test_random(&seed) % 300; \
+			} \
+			name##_check(data, len, split_1, 1, "in 1 byte updates"); \
+			name##_check(data, len, split_63, 1, "in 63 byte updates"); \
+			name##_check(data, len, split_64, 1, "in 64 byte updates"); \
+			name##_check(data, len, split_65, 1, "in 65 byte updates"); \
+			name##_check(data, len, split_mixed, sizeof(split_mixed) / sizeof(*split_mixed), "in mixed updates"); \
+			name##_check(data, len, random_sizes, RANDOM_SPLITS, "at random points"); \
+			name##_check_clone(data, other, both, len == 0 ? 0 : test_random(&seed) % (len + 1), len); \
+		} \
+	}
+
+DEFINE_CHECKS(md5, hash128)
+DEFINE_CHECKS(sha256, hash256)
+DEFINE_CHECKS(whirlpool, hash512)
+
+int main(void) {
+	uint8_t *data = test_malloc(MAX_LEN);
+	uint8_t *other = test_malloc(MAX_LEN);
+	uint8_t *both = test_malloc(MAX_LEN);
+	test_fill(data, MAX_LEN, 15);
+	test_fill(other, MAX_LEN, 51);
+
+	md5_check_all(data, other, both, "900150983cd24fb0d6963f7d28e17f72");
+	sha256_check_all(data, other, both, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	whirlpool_check_all(data, other, both, "4e2448a4c6f486bb16b6562c73b4020bf3043e3a731bce721ae1b303d97e6d4c"
+		"7181eebdb6c57e277d0e34957114cbd6c797fc9d95d8b582d225292076d4eef5");
+
+	free(data);
+	free(other);
+	free(both);
+	return test_result("context");
+}
@@ -0,0 +1,44 @@
+# Sourced by the test scripts, which are run as `sh tests/NAME.sh path/to/ft_ssl`
+# They work in a temporary directory, $TMP, which is removed when they exit
+
+FT_SSL=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP" || exit 2
+failures=0
+
+fail() {
+	echo "$NAME: $*" >&2
+	failures=$((failures + 1))
+}
+
+# expect_same DESCRIPTION FILE EXPECTED_FILE
+expect_same() {
+	if ! cmp -s "$2" "$3"; then
+		fail "$1"
+		diff "$3" "$2" | head -n 10 >&2
+	fi
+}
+
+# expect_status DESCRIPTION EXPECTED ACTUAL
+expect_status() {
+	[ "$3" -eq "$2" ] || fail "$1: exit status $3, expected $2"
+}
+
+# make_files DIR COUNT: files of every size from 0 to a few blocks, some of them past the multi-buffer limit
+make_files() {
+	mkdir -p "$1"
+	i=0
+	while [ $i -lt "$2" ]; do
+		head -c $(( (i * 37) % 300 + (i % 50 == 7) * 70000 )) /dev/urandom > "$1/f$i"
+		i=$((i + 1))
+	done
+}
+
+finish() {
+	if [ $failures -gt 0 ]; then
+		echo "$NAME: $failures failure(s)" >&2
+		exit 1
+	fi
+	echo "$NAME: ok"
+}
@@ -0,0 +1,107 @@
+// Runs every multi-buffer kernel of md5 and sha256 the cpu supports on batches of messages of unequal lengths,
+// empty ones included, so that lanes finish and take the next job in the middle of a batch,
+// and compares every hash to the scalar one
+
+#include "context.h"
+#include "multibuffer.h"
+#include "test.h"
+
+#define JOB_NUM 300
+#define MAX_LEN 3000
+
+struct mb_case {
+	char const *name;
+	struct mb_algorithm const *(*kernel)(size_t index);
+	size_t hash_size;
+	void (*scalar)(uint8_t const *data, size_t len, void *hash);
+};
+
+static void md5_scalar(uint8_t const *data, size_t len, void *hash) {
+	struct md5_ctx ctx;
+	md5_init(&ctx);
+	md5_update(&ctx, data, len);
+	md5_final(&ctx, hash);
+}
+
+static void sha256_scalar(uint8_t const *data, size_t len, void *hash) {
+	struct sha256_ctx ctx;
+	sha256_init(&ctx);
+	sha256_update(&ctx, data, len);
+	sha256_final(&ctx, hash);
+}
+
+/// Hashes the first `job_num` lengths as one batch
+static void check_batch(struct mb_case const *c, struct mb_algorithm const *alg, uint8_t const *data, size_t const *lens, size_t job_num) {
+	struct mb_job *jobs = test_malloc(job_num * sizeof(*jobs));
+	uint8_t *hashes = test_malloc(job_num * c->hash_size);
+	uint8_t expected[64];
+
+	// Every message starts somewhere else in `data`, unaligned for most
+	for (size_t i = 0; i < job_num; i++) {
+		jobs[i] = (struct mb_job){ .data = data + i * 7 % 512, .len = lens[i], .hash = hashes + i * c->hash_size };
+	}
+	mb_hash_jobs(alg, jobs, job_num);
+
+	for (size_t i = 0; i < job_num; i++) {
+		c->scalar(jobs[i].data, jobs[i].len, expected);
+		CHECK(memcmp(jobs[i].hash, expected, c->hash_size) == 0, "%s %s: job %zu of %zu (%zu bytes) differs from scalar",
+			c->name, alg->name, i, job_num, jobs[i].len);
+	}
+	free(jobs);
+	free(hashes);
+}
+
+static void check_kernel(struct mb_case const *c, struct mb_algorithm const *alg, uint8_t const *data) {
+	size_t lens[JOB_NUM];
+	uint64_t seed = 0x6d622d6c656e73;
+	size_t const edge_num = sizeof(test_edge_lengths) / sizeof(*test_edge_lengths);
+	for (size_t i = 0; i < JOB_NUM; i++) {
+		if (i % 11 == 0) {
+			lens[i] = 0;
+		} else if (i % 5 == 0) {
+			lens[i] = test_edge_lengths[i / 5 % edge_num];
+		} else {
+			lens[i] = test_random(&seed) % MAX_LEN;
+		}
+	}
+
+	// Fewer jobs than lanes, one per lane, one more than that, and many batches' worth
+	size_t const counts[] = { 1, 2, alg->lanes - 1, alg->lanes, alg->lanes + 1, 2 * alg->lanes + 3, JOB_NUM };
+	for (size_t i = 0; i < sizeof(counts) / sizeof(*counts); i++) {
+		check_batch(c, alg, data, lens, counts[i]);
+	}
+
+	// Only empty messages, and one long message among short ones
+	size_t same[JOB_NUM] = {0};
+	check_batch(c, alg, data, same, alg->lanes + 2);
+	for (size_t i = 0; i < JOB_NUM; i++) {
+		same[i] = i == 3 ? test_edge_lengths[edge_num - 1] : i % 3;
+	}
+	check_batch(c, alg, data, same, JOB_NUM);
+}
+
+static void check_case(struct mb_case const *c, uint8_t const *data) {
+	size_t i = 0;
+	for (struct mb_algorithm const *alg; (alg = c->kernel(i)) != NULL; i++) {
+		check_kernel(c, alg, data);
+	}
+	if (i == 0) {
+		printf("%s: no multi-buffer kernel on this cpu, skipped\n", c->name);
+	}
+}
+
+int main(void) {
+	static struct mb_case const cases[] = {
+		{ "md5", &md5_mb_kernel, sizeof(struct hash128), &md5_scalar },
+		{ "sha256", &sha256_mb_kernel, sizeof(struct hash256), &sha256_scalar },
+	};
+	size_t const size = 512 + 65536 + 8;
+	uint8_t *data = test_malloc(size);
+	test_fill(data, size, 8);
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(*cases); i++) {
+		check_case(&cases[i], data);
+	}
+	free(data);
+	return test_result("multibuffer");
+}
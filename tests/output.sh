@@ -0,0 +1,58 @@
+# Buffered output writes the same bytes as one write per string did: md5sum's results in ft_ssl's format,
+# errors in their place, whether stdout is a file or a pipe closed early, and when a signal kills the process
+NAME=output
+. "$(dirname "$0")/lib.sh"
+
+# More output than fits in the buffer
+make_files files 3000
+set -- files/*
+
+# md5sum's output in ft_ssl's format
+reformat() {
+	sed 's/^\([0-9a-f]*\)  \(.*\)$/MD5(\2)= \1/'
+}
+
+# expected FILES...: the output of ft_ssl md5, missing files get the error message
+expected() {
+	for file in "$@"; do
+		if [ -e "$file" ]; then
+			md5sum "$file" | reformat
+		else
+			echo "ft_ssl: Error: md5: $file: No such file or directory"
+		fi
+	done
+}
+
+md5sum "$@" | reformat > expected
+"$FT_SSL" md5 "$@" > out 2>&1
+expect_same "redirected to a file" out expected
+
+"$FT_SSL" md5 "$@" | head -n 1 > out
+head -n 1 expected > first
+expect_same "piped to head -n 1" out first
+"$FT_SSL" md5 "$@" | head -c 100000 > out
+head -c 100000 expected > first
+expect_same "piped to head -c 100000" out first
+"$FT_SSL" md5 "$@" | cat > out
+expect_same "piped to cat" out expected
+
+# Errors come after the results before them, stdout and stderr going to the same file
+set -- files/f1 missing1 files/f2 files/f3 missing2 files/f2999
+expected "$@" > expected
+"$FT_SSL" md5 "$@" > out 2>&1
+expect_same "errors in their place" out expected
+
+# Once ft_ssl opens the fifo the results before it are printed, a signal that kills it must not lose them
+head -c 100000 /dev/urandom > large
+mkfifo fifo
+"$FT_SSL" md5 large files/f1 fifo > out 2> /dev/null &
+pid=$!
+exec 3> fifo
+kill -BUS $pid
+wait $pid 2> /dev/null
+expect_status "killed by SIGBUS" 135 $?
+exec 3>&-
+expected large files/f1 > expected
+expect_same "killed by SIGBUS" out expected
+
+finish
@@ -0,0 +1,34 @@
+# -j N must print what -j 1 prints, -unordered the same lines in any order
+NAME=parallel
+. "$(dirname "$0")/lib.sh"
+
+make_files files 300
+head -c 3000000 /dev/urandom > files/large
+set -- files/f* files/large files/missing
+
+for alg in md5 sha256 whirlpool sha512 blake3; do
+	"$FT_SSL" $alg -j 1 "$@" > ordered 2>&1
+	for jobs in 2 4 0; do
+		"$FT_SSL" $alg -j $jobs "$@" > out 2>&1
+		expect_same "$alg -j $jobs differs from -j 1" out ordered
+	done
+	"$FT_SSL" $alg "$@" > out 2>&1
+	expect_same "$alg without -j differs from -j 1" out ordered
+
+	sort ordered > sorted
+	"$FT_SSL" $alg -j 4 -unordered "$@" 2>&1 | sort > out
+	expect_same "$alg -j 4 -unordered sorted differs from -j 1 sorted" out sorted
+done
+
+# A file that can't be read is reported in its place, the files after it are still hashed, and the command fails
+mkdir files/dir
+"$FT_SSL" md5 files/f1 > expected
+echo "ft_ssl: Error: md5: files/dir: Is a directory" >> expected
+"$FT_SSL" md5 files/f2 files/f3 >> expected
+for jobs in 1 4; do
+	"$FT_SSL" md5 -j $jobs files/f1 files/dir files/f2 files/f3 > out 2>&1
+	expect_status "md5 -j $jobs with a directory in the list" 1 $?
+	expect_same "md5 -j $jobs with a directory in the list" out expected
+done
+
+finish
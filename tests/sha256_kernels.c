@@ -0,0 +1,84 @@
+// Runs every entry of `sha256_kernels` the cpu supports against `sha256_rounds_scalar`
+// on the FIPS 180-2 vectors and on random inputs of many lengths, aligned or not
+
+#include "sha256.h"
+#include "sha256_kernels.h"
+#include "test.h"
+
+/// Hashes `len` bytes with nothing but `rounds`, the padding included
+static struct hash256 kernel_hash(t_sha256_rounds *rounds, uint8_t const *data, size_t len) {
+	struct sha256_state state = sha256_state();
+	rounds(&state, data, len / 64);
+	uint8_t tail[128];
+	size_t blocks = sha256_padding(tail, data + len / 64 * 64, len % 64 * 8, (uint64_t)len * 8);
+	rounds(&state, tail, blocks);
+
+	uint32_t const words[8] = { state.a, state.b, state.c, state.d, state.e, state.f, state.g, state.h };
+	struct hash256 hash;
+	for (size_t i = 0; i < 8; i++) {
+		for (size_t j = 0; j < 4; j++) {
+			hash.hash[i * 4 + j] = (uint8_t)(words[i] >> (24 - j * 8));
+		}
+	}
+	return hash;
+}
+
+static void check_kernel(struct sha256_kernel const *kernel, uint8_t const *data, size_t len) {
+	struct hash256 expected = kernel_hash(&sha256_rounds_scalar, data, len);
+	struct hash256 hash = kernel_hash(kernel->rounds, data, len);
+	CHECK(memcmp(&hash, &expected, sizeof(hash)) == 0, "%s differs from scalar on %zu bytes", kernel->name, len);
+}
+
+static void check_vectors(struct sha256_kernel const *kernel) {
+	static struct { char const *input; size_t repeat; char const *hex; } const vectors[] = {
+		{ "", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+		{ "abc", 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+		{ "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+			"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+		{ "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1,
+			"cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1" },
+		{ "a", 1000000, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+	};
+	for (size_t v = 0; v < sizeof(vectors) / sizeof(*vectors); v++) {
+		size_t part = strlen(vectors[v].input);
+		size_t len = part * vectors[v].repeat;
+		uint8_t *data = test_malloc(len);
+		for (size_t i = 0; i < vectors[v].repeat; i++) {
+			memcpy(data + i * part, vectors[v].input, part);
+		}
+		struct hash256 hash = kernel_hash(kernel->rounds, data, len);
+		struct hash256_hex hex = hash256_hex(&hash);
+		CHECK(strcmp(hex.hex, vectors[v].hex) == 0, "%s: vector %zu gives %s", kernel->name, v, hex.hex);
+		free(data);
+	}
+}
+
+int main(void) {
+	size_t const max_len = 5 * 1024 * 1024 + 17;
+	uint8_t *data = test_malloc(max_len + 1);
+	test_fill(data, max_len + 1, 6);
+	uint64_t seed = 256;
+
+	for (size_t k = 0; sha256_kernels[k].name != NULL; k++) {
+		struct sha256_kernel const *kernel = &sha256_kernels[k];
+		if (!kernel->supported()) {
+			printf("sha256_kernels: %s is not supported by this cpu, skipped\n", kernel->name);
+			continue;
+		}
+		check_vectors(kernel);
+		for (size_t len = 0; len <= 300; len++) {
+			check_kernel(kernel, data, len);
+			check_kernel(kernel, data + 1, len);
+		}
+		for (size_t i = 0; i < sizeof(test_edge_lengths) / sizeof(*test_edge_lengths); i++) {
+			check_kernel(kernel, data + 1, test_edge_lengths[i]);
+		}
+		for (size_t i = 0; i < 64; i++) {
+			check_kernel(kernel, data + test_random(&seed) % 64, test_random(&seed) % (256 * 1024));
+		}
+		check_kernel(kernel, data, 3 * 1024 * 1024);
+		check_kernel(kernel, data + 1, max_len);
+	}
+	free(data);
+	return test_result("sha256_kernels");
+}
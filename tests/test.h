@@ -0,0 +1,58 @@
+#pragma once
+
+// Helpers shared by the test programs run by `make test`
+// A test checks everything it can, prints each failure, and exits with 1 when there was any
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond, ...) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+		fprintf(stderr, __VA_ARGS__); \
+		fputc('\n', stderr); \
+		test_failures++; \
+	} \
+} while (0)
+
+/// xorshift64*, the inputs are the same on every run
+static inline uint64_t test_random(uint64_t *seed) {
+	*seed ^= *seed >> 12;
+	*seed ^= *seed << 25;
+	*seed ^= *seed >> 27;
+	return *seed * 0x2545f4914f6cdd1dULL;
+}
+
+static inline void test_fill(uint8_t *data, size_t len, uint64_t seed) {
+	seed |= 1;
+	for (size_t i = 0; i < len; i++) {
+		data[i] = (uint8_t)(test_random(&seed) >> 56);
+	}
+}
+
+/// Lengths around the block and padding edges of 64-byte blocks, and a few multi-block ones
+static size_t const test_edge_lengths[] = {
+	0, 1, 55, 56, 57, 63, 64, 65, 119, 120, 121, 127, 128, 129, 191, 192, 1000, 4096, 65536 + 7,
+};
+
+static inline void *test_malloc(size_t size) {
+	void *p = malloc(size == 0 ? 1 : size);
+	if (p == NULL) {
+		perror("malloc");
+		exit(2);
+	}
+	return p;
+}
+
+static inline int test_result(char const *name) {
+	if (test_failures > 0) {
+		fprintf(stderr, "%s: %d failure%s\n", name, test_failures, test_failures == 1 ? "" : "s");
+		return 1;
+	}
+	printf("%s: ok\n", name);
+	return 0;
+}
@@ -0,0 +1,58 @@
+# -tree known answers for 1, 2, 3 and 2^k + 1 leaves, from a file, from stdin and on 4 threads
+# The roots were computed with another implementation: leaves are H(0x00 || chunk), nodes H(0x01 || left || right),
+# and the last node of a level with an odd count goes up as it is
+NAME=tree
+. "$(dirname "$0")/lib.sh"
+
+# make_data SIZE: the same bytes on every run
+make_data() {
+	yes 0123456789abcdef | head -c "$1"
+}
+
+# algorithm, chunk, size, leaves, root
+while read -r alg chunk size leaves root; do
+	[ -f "data$size" ] || make_data "$size" > "data$size"
+	if [ "$leaves" -eq 1 ]; then
+		echo "$root (1 leaf)" > expected
+	else
+		echo "$root ($leaves leaves)" > expected
+	fi
+	"$FT_SSL" $alg -q -leaves -tree $chunk "data$size" > out 2>&1
+	expect_same "$alg -tree $chunk of $size bytes" out expected
+	"$FT_SSL" $alg -q -leaves -tree $chunk -j 4 "data$size" > out 2>&1
+	expect_same "$alg -tree $chunk -j 4 of $size bytes" out expected
+	"$FT_SSL" $alg -q -leaves -tree $chunk < "data$size" > out 2>&1
+	expect_same "$alg -tree $chunk of $size bytes from stdin" out expected
+done <<EOF
+md5 1K 0 1 93b885adfe0da089cdf634904fd59f71
+md5 1K 1000 1 c059f669739f95a086b570ae97d19170
+md5 1K 1024 1 5e80979c4ec4b15dad110ea4068be3cc
+md5 1K 1025 2 b1ab7e3de7ac281d97c44c3f9a404865
+md5 1K 2048 2 a83d0dc249669bc40ba7c337a03a5a14
+md5 1K 3000 3 1a759014226707280a85edff96c53fce
+md5 1K 5120 5 03b533a5e466f06fc5a1736cc864f5d1
+md5 1K 8193 9 dc3a0bd7d9a6c571de8577aeb501bb45
+md5 64 2049 33 7eaed44858cdd5a94904bf3472032a3a
+md5 64K 1048577 17 55c43aa9beb229216133a26fc66e52a1
+md5 1M 4194305 5 9b6be97760ae8447f781bbd4652a0df9
+sha256 1K 0 1 6e340b9cffb37a989ca544e6bb780a2c78901d3fb33738768511a30617afa01d
+sha256 1K 1000 1 16bc36c390bb52940b402b522192d4929e7ee75a6ee4b84c5885d88c96a81d48
+sha256 1K 1024 1 e94e0b663c0df57439902de4ed8c9fb11a98146132746feb0af225aa2c780d18
+sha256 1K 1025 2 1ba68948dce2674e18cd70adb4e13dfbc77b4ed6f8ec1a32b39c209a1427c879
+sha256 1K 2048 2 d7e214a992b4b62d06836cabddaad2b4a44b2a20d12f5d09b8377caa095343fe
+sha256 1K 3000 3 9525e84c47c87ef4e6dba0d0e99c6a5297ef52749324516b112a792234a8c900
+sha256 1K 5120 5 55032b5a2b2051cd3453b262b5c07d2a1ec0d9f09f16c0557a84639ba0a2322a
+sha256 1K 8193 9 64d6d2ef0915c87ca4b8f7629307ef69761f9804892b1f1f49d503700d479a53
+sha256 64 2049 33 e7efe1f59cc74c33f3675d56ff576e13345019ec548dbaf84ca43bd9bdbe03cd
+sha256 64K 1048577 17 f1975ef82980569b617d9739c6d3b90652664a9ba26a2982d867ce324b25fef3
+sha256 1M 4194305 5 394c93869fe4c1ec3ea6a1a2af6ee2f091e8875a1f30d2f4e48567279f295772
+EOF
+
+# Many files at once, the output of -j 4 is the output of -j 1
+for chunk in 64 1K 64K; do
+	"$FT_SSL" sha256 -leaves -tree $chunk -j 1 data* > ordered 2>&1
+	"$FT_SSL" sha256 -leaves -tree $chunk -j 4 data* > out 2>&1
+	expect_same "sha256 -tree $chunk -j 4 differs from -j 1" out ordered
+done
+
+finish
@@ -0,0 +1,117 @@
+# -R lists the regular files depth first, the entries of each directory sorted by name (strcmp),
+# so a/b/y comes before a.txt, symlinks are skipped unless -L, loops are reported, -x stays on one filesystem
+NAME=walk
+. "$(dirname "$0")/lib.sh"
+
+mkdir -p t/a/b t/empty
+echo y > t/a/b/y
+echo z > t/a/z
+echo 1 > t/a.txt
+echo b > t/b
+echo B > t/B
+echo h > t/.hidden
+ln -s a.txt t/link
+ln -s a t/dirlink
+ln -s missing t/broken
+mkfifo t/fifo
+
+# walk DESCRIPTION ARGS... < EXPECTED_PATHS: -R prints the hashes of these files, in this order
+walk() {
+	desc=$1
+	shift
+	"$FT_SSL" md5 -r $(cat) > expected 2>&1
+	"$FT_SSL" md5 -r -R "$@" > out 2>&1
+	expect_same "$desc" out expected
+}
+
+walk "order" t <<EOF
+t/.hidden
+t/B
+t/a/b/y
+t/a/z
+t/a.txt
+t/b
+EOF
+
+walk "-P" -P t <<EOF
+t/.hidden
+t/B
+t/a/b/y
+t/a/z
+t/a.txt
+t/b
+EOF
+
+walk "-L" -L t <<EOF
+t/.hidden
+t/B
+t/a/b/y
+t/a/z
+t/a.txt
+t/b
+t/dirlink/b/y
+t/dirlink/z
+t/link
+EOF
+
+walk "roots in the given order, symlinks and files as they are" t/link t/a t/b t/missing <<EOF
+t/link
+t/a/b/y
+t/a/z
+t/b
+t/missing
+EOF
+
+# A symlink to an ancestor is reported where its entries would have been
+ln -s ../.. t/a/b/up
+"$FT_SSL" md5 -r -R -L t > out 2>&1
+{
+	echo "ft_ssl: Error: md5: t/a/b/up: Too many levels of symbolic links"
+	"$FT_SSL" md5 -r t/a/b/y t/a/z t/a.txt t/b
+	echo "ft_ssl: Error: md5: t/dirlink/b/up: Too many levels of symbolic links"
+	"$FT_SSL" md5 -r t/dirlink/b/y t/dirlink/z t/link
+} > tail
+{ "$FT_SSL" md5 -r t/.hidden t/B; cat tail; } > expected
+expect_same "symlink loop" out expected
+rm t/a/b/up
+
+# Many directories and files, against `ls` sorting each directory on its own; '-' and '.' sort before '/'
+make_files tree/x 300
+make_files tree/x/y 50
+make_files tree/x.y 20
+make_files tree/x-a 20
+make_files tree/x/y/z/w 5
+model() {
+	for entry in $(LC_ALL=C ls -A "$1"); do
+		if [ -d "$1/$entry" ]; then
+			model "$1/$entry"
+		else
+			echo "$1/$entry"
+		fi
+	done
+}
+model tree > paths
+walk "many directories" tree < paths
+"$FT_SSL" md5 -r -R -j 4 tree > out 2>&1
+expect_same "many directories with -j 4" out expected
+
+# -x: a directory on another filesystem, reached through a symlink, is not entered
+other=$(mktemp -d /dev/shm/ft_ssl.XXXXXX 2> /dev/null)
+if [ -n "$other" ] && [ "$(stat -c %d "$other")" != "$(stat -c %d .)" ]; then
+	echo s > "$other/s"
+	mkdir x
+	echo v > x/v
+	ln -s "$other" x/other
+	walk "-L without -x" -L x <<EOF
+x/other/s
+x/v
+EOF
+	walk "-L -x" -L -x x <<EOF
+x/v
+EOF
+else
+	echo "$NAME: no other filesystem in /dev/shm, -x not checked"
+fi
+[ -n "$other" ] && rm -rf "$other"
+
+finish
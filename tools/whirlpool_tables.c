@@ -0,0 +1,143 @@
+// Prints the tables of the 64-bit Whirlpool kernel as a C header, run by the Makefile at build time
+//
+// The state is 8 rows of 8 bytes, byte `x` of a row is stored in bits `8x` of a uint64_t
+// One round maps row `y` to the XOR over `k` of `T[k][byte k of row (y - k) mod 8]`,
+// where `T[k][v]` holds `S[v]` multiplied in GF(2^8) by each entry of row `k` of the circulant MDS matrix
+// That fuses the S-box (gamma), the column shift (pi) and the row mixing (theta) into 8 lookups per row
+//
+// It also prints the byte shuffles of the vector-permute kernel, which keeps two rows per 16-byte register
+
+#include <stdint.h>
+#include <stdio.h>
+
+/// The S-box is built from these 4-bit mini-boxes, as described in the Whirlpool specification
+static uint8_t const e_box[16] = { 0x1, 0xb, 0x9, 0xc, 0xd, 0x6, 0xf, 0x3, 0xe, 0x8, 0x7, 0x4, 0xa, 0x2, 0x5, 0x0 };
+static uint8_t const r_box[16] = { 0x7, 0xc, 0xb, 0xd, 0xe, 0x4, 0x9, 0xf, 0x6, 0x3, 0x8, 0xa, 0x2, 0x5, 0x1, 0x0 };
+
+/// First row of the circulant matrix, row `k` is this one rotated right by `k`
+static uint8_t const mds_row[8] = { 1, 1, 4, 1, 8, 5, 2, 9 };
+
+/// Multiplication in GF(2^8) with the reduction polynomial x^8 + x^4 + x^3 + x^2 + 1
+static uint8_t gf_mul(uint8_t a, uint8_t b) {
+	uint8_t res = 0;
+	while (b != 0) {
+		if ((b & 1) != 0) {
+			res ^= a;
+		}
+		a = (a << 1) ^ ((a & 0x80) != 0 ? 0x1d : 0);
+		b >>= 1;
+	}
+	return res;
+}
+
+static uint8_t e_inv[16];
+
+static void build_s_box(uint8_t s_box[256]) {
+	for (uint8_t i = 0; i < 16; i++) {
+		e_inv[e_box[i]] = i;
+	}
+	for (unsigned v = 0; v < 256; v++) {
+		uint8_t hi = e_box[v >> 4];
+		uint8_t lo = e_inv[v & 0xf];
+		uint8_t r = r_box[hi ^ lo];
+		s_box[v] = (e_box[hi ^ r] << 4) | e_inv[lo ^ r];
+	}
+}
+
+static void print_bytes(char const *indent, uint8_t const bytes[16]) {
+	printf("%s{", indent);
+	for (unsigned i = 0; i < 16; i++) {
+		printf("0x%.2x%s", bytes[i], i == 15 ? "},\n" : ", ");
+	}
+}
+
+/// The register with rows `2j` and `2j + 1` keeps byte `x` of row `y` at `(y % 2) * 8 + x`
+/// Entry `[j][i]` moves the bytes of register `i` that the column shift sends to register `j`, 0x80 clears a byte
+static void print_shift_masks(void) {
+	printf("static uint8_t const whirlpool_shift_masks[4][4][16] = {\n");
+	for (unsigned j = 0; j < 4; j++) {
+		printf("\t{\n");
+		for (unsigned i = 0; i < 4; i++) {
+			uint8_t mask[16];
+			for (unsigned p = 0; p < 16; p++) {
+				unsigned y = j * 2 + p / 8;
+				unsigned x = p % 8;
+				unsigned from = (y - x) & 7;
+				mask[p] = from / 2 == i ? (from % 2) * 8 + x : 0x80;
+			}
+			print_bytes("\t\t", mask);
+		}
+		printf("\t},\n");
+	}
+	printf("};\n\n");
+}
+
+/// Entry `d` rotates both rows of a register, so that byte `x` is taken from byte `x - d`
+static void print_rotate_masks(void) {
+	printf("static uint8_t const whirlpool_rotate_masks[8][16] = {\n");
+	for (unsigned d = 0; d < 8; d++) {
+		uint8_t mask[16];
+		for (unsigned p = 0; p < 16; p++) {
+			mask[p] = (p / 8) * 8 + ((p - d) & 7);
+		}
+		print_bytes("\t", mask);
+	}
+	printf("};\n\n");
+}
+
+int main(void) {
+	uint8_t s_box[256];
+	build_s_box(s_box);
+
+	printf("// Generated by tools/whirlpool_tables.c, do not edit\n");
+	printf("#pragma once\n\n#include <stdint.h>\n\n");
+
+	printf("static uint64_t const whirlpool_t[8][256] = {\n");
+	for (unsigned k = 0; k < 8; k++) {
+		uint64_t table[256];
+		for (unsigned v = 0; v < 256; v++) {
+			table[v] = 0;
+			for (unsigned x = 0; x < 8; x++) {
+				table[v] |= (uint64_t)gf_mul(s_box[v], mds_row[(x - k) & 7]) << (x * 8);
+			}
+		}
+		printf("\t{\n");
+		for (unsigned v = 0; v < 256; v += 4) {
+			printf("\t\t0x%.16llxULL, 0x%.16llxULL, 0x%.16llxULL, 0x%.16llxULL,\n",
+				(unsigned long long)table[v], (unsigned long long)table[v + 1],
+				(unsigned long long)table[v + 2], (unsigned long long)table[v + 3]);
+		}
+		printf("\t},\n");
+	}
+	printf("};\n\n");
+
+	// Round `r` adds S[8r], ..., S[8r + 7] to the first row of the key
+	uint64_t rc[10];
+	for (unsigned r = 0; r < 10; r++) {
+		rc[r] = 0;
+		for (unsigned x = 0; x < 8; x++) {
+			rc[r] |= (uint64_t)s_box[r * 8 + x] << (x * 8);
+		}
+	}
+	printf("static uint64_t const whirlpool_rc[10] = {\n");
+	for (unsigned r = 0; r < 10; r++) {
+		printf("\t0x%.16llxULL,\n", (unsigned long long)rc[r]);
+	}
+	printf("};\n\n");
+
+	// Nibble lookups of the S-box: E, E shifted to the high nibble, the inverse of E, and R
+	uint8_t e_high[16];
+	for (unsigned i = 0; i < 16; i++) {
+		e_high[i] = e_box[i] << 4;
+	}
+	printf("static uint8_t const whirlpool_mini_boxes[4][16] = {\n");
+	print_bytes("\t", e_box);
+	print_bytes("\t", e_high);
+	print_bytes("\t", e_inv);
+	print_bytes("\t", r_box);
+	printf("};\n\n");
+
+	print_shift_masks();
+	print_rotate_masks();
+	return 0;
+}